@@ -0,0 +1,133 @@
+/*
+ * acq.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_ACQ_H_
+#define APP_INC_ACQ_H_
+
+#include <stdint.h>
+#include "adc.h"
+#include "summary.h"
+#include "fft.h"
+
+// Number of periods (records) in one acquisition
+#define ACQ_N_PERIODS ADC_MAX_DATA_SIZE
+
+// Period numbers of the first overruns are kept for the report
+#define ACQ_OVERRUN_LOG_SIZE 8
+// With automatic load reduction, divide-by is doubled after this many overruns
+#define ACQ_OVERRUN_RAISE_AFTER 8
+
+// Before arming the ADC, TIM15 must count the signal on PB14: the input rate is measured
+// over this time at least, and until two input periods are counted (up to ACQ_TIMEOUT_MAX_MS)
+#define ACQ_SIGNAL_CHECK_MS 10
+// Stage timeout in expected window periods (from the rate measured by the check), plus a margin
+#define ACQ_TIMEOUT_PERIODS 4
+#define ACQ_TIMEOUT_MARGIN_MS 10
+#define ACQ_TIMEOUT_MAX_MS 10000
+
+// Early stop: default least number of periods before the confidence interval is trusted
+#define ACQ_MIN_PERIODS_DEFAULT 16
+
+// Stage an acquisition timed out in
+enum ACQ_Stage
+{
+	ACQ_STAGE_NONE = 0,
+	ACQ_STAGE_SIGNAL,	// TIM15 count not changing (PB14)
+	ACQ_STAGE_WINDOW,	// no TIM15 overflow, ADC window never started (PB14)
+	ACQ_STAGE_CAPTURE,	// window done, no TIM1 capture (PA8)
+};
+
+struct ACQ_Overrun_Stats
+{
+	unsigned int count;
+	unsigned short log[ACQ_OVERRUN_LOG_SIZE];	// record number when the period was skipped
+	unsigned short divide_by_start;
+	unsigned short divide_by_end;
+	unsigned short raised_at;	// first record taken with the raised divide-by (ACQ_N_PERIODS if none)
+};
+
+// Applied by ACQ_Restart()
+struct ACQ_Settings
+{
+	unsigned short psc;			// TIM1 prescaler
+	unsigned short divide_by;	// TIM15 periods per window
+	unsigned short n_periods;	// records per run, up to ACQ_N_PERIODS
+	unsigned short tolerance;	// early stop once the 95 % confidence intervals of the means are
+								// within this many 0.01 % of the means (amplitude and period), 0 = off
+	unsigned short min_periods;	// early stop not before this many records
+	unsigned char smpr;			// ADC1->SMPR
+	unsigned char auto_divide;
+};
+
+// Timing of the run so far, in TIM2 cycles
+struct ACQ_Timing
+{
+	unsigned int slack_min;			// ADC re-armed to next TIM15 overflow
+	unsigned int trigger_period;	// between the last two TIM15 overflows
+};
+
+// Results of the runs: raw arrays filled from the period records, or the summary
+// points of a sweep (summary mode), never both
+union ACQ_Results
+{
+	struct
+	{
+		uint16_t timer_cnt[ACQ_N_PERIODS];		// TIM1->CCR1
+		uint16_t adc_max_data[ACQ_N_PERIODS];	// max of the ADC window
+		uint32_t period_time[ACQ_N_PERIODS];	// capture time, us since the start of the run
+	};
+	struct SUM_Point points[SUM_N_POINTS];
+};
+
+extern union ACQ_Results acq_results;
+
+// Work memory of the window modes of the bottom half: averaging or spectrum, never both
+union ACQ_Work
+{
+	// Sums of the windows, the averaged window (AVG_SCALE per code) is written over them
+	// by AVG_Get_Result()
+	union
+	{
+		uint32_t acc[ADC_ACQ_DATA_SIZE];
+		uint16_t data[ADC_ACQ_DATA_SIZE];
+	} average;
+
+	// Sum of the bin magnitudes and work buffer of the packed FFT
+	struct
+	{
+		uint32_t acc[FFT_N_BINS];
+		union FFT_Buffer buffer;
+	} fft;
+};
+
+extern union ACQ_Work acq_work;
+
+void ACQ_Start(void);
+void ACQ_Abort(void);
+void ACQ_Finish(void);
+void ACQ_Tick(void);
+void ACQ_Restart(const struct ACQ_Settings* settings);
+void ACQ_Apply_Settings(const struct ACQ_Settings* settings);
+void ACQ_Get_Settings(struct ACQ_Settings* settings);
+const struct ACQ_Timing* ACQ_Get_Timing(void);
+void ACQ_Capture(const unsigned short capture);
+void ACQ_Bottom_Half(void);
+unsigned int ACQ_Consume(void);
+unsigned int ACQ_Records_Received(void);
+unsigned int ACQ_Get_Trough(void);
+uint64_t ACQ_Start_Time(void);
+unsigned char ACQ_Run_Id(void);
+unsigned char ACQ_Running(void);
+unsigned char ACQ_Aborted(void);
+unsigned char ACQ_Converged(void);
+unsigned char ACQ_Timeout_Stage(void);
+unsigned char ACQ_Trigger_Missed(const unsigned int trigger_time);
+void ACQ_Overrun(void);
+void ACQ_Set_Auto_Divide(const unsigned char enable);
+unsigned char ACQ_Get_Auto_Divide(void);
+const struct ACQ_Overrun_Stats* ACQ_Get_Overrun_Stats(void);
+
+#endif /* APP_INC_ACQ_H_ */
@@ -11,11 +11,37 @@
 #define ADC_MAX_DATA_SIZE 1024
 #define ADC_ACQ_DATA_SIZE 256
 
+// Largest code of the 10-bit conversions (RES = 01)
+#define ADC_FULL_SCALE 1023
+
+// Window complete (DMA1 CH1), ADC ready and state polling (TIM6) interrupts
+#define ADC_INT_PRIORITY 1
+
+// ADSTP and ADDIS have no completion interrupt: TIM6 checks them again after this delay (us)
+#define ADC_POLL_DELAY_US 2
+
+enum ADC_State
+{
+	ADC_STATE_OFF = 0,		// ADEN cleared
+	ADC_STATE_ENABLING,		// ADEN set, waiting for ADRDY
+	ADC_STATE_READY,		// enabled, no conversion
+	ADC_STATE_ARMED,		// ADSTART set, window runs on next TIM15_TRGO
+	ADC_STATE_STOPPING,		// ADSTP set
+	ADC_STATE_DISABLING,	// ADDIS set
+};
+
+// Completion callbacks run in interrupt context (or in the caller when already done)
+typedef void (*ADC_Callback)(void);
+
 void ADC_Init(void);
-void ADC_ACQ_Enable(void);
-void ADC_ACQ_Disable(void);
-void ADC_Set_SMPR(const unsigned char smpr);
-unsigned short ADC_Find_Max_Value(void);
-unsigned char ADC_Update_Max_Data(void);
+void ADC_NVIC_Init(void);
+void ADC_Async_Arm(ADC_Callback window_done);
+void ADC_Async_Disable(ADC_Callback done);
+void ADC_Async_Set_SMPR(const unsigned char smpr, ADC_Callback done);
+void ADC_Async_Service(void);
+unsigned char ADC_Get_State(void);
+void ADC_IRQ_Process(void);
+void ADC_DMA_IRQ_Process(void);
+unsigned short ADC_Find_Max_Value(unsigned short* min);
 
 #endif /* APP_INC_ADC_H_ */
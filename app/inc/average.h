@@ -0,0 +1,26 @@
+/*
+ * average.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_AVERAGE_H_
+#define APP_INC_AVERAGE_H_
+
+// Averaged window in 1/16 of ADC code
+#define AVG_SCALE 16
+
+struct AVG_Result
+{
+	unsigned int windows;		// windows summed
+	unsigned int max;			// hundredths of ADC code, peak of the averaged window
+	unsigned int min;
+};
+
+void AVG_Set_Enable(const unsigned char enable);
+unsigned char AVG_Get_Enable(void);
+void AVG_Reset(void);
+void AVG_Window(void);
+unsigned char AVG_Get_Result(struct AVG_Result* result);
+
+#endif /* APP_INC_AVERAGE_H_ */
@@ -0,0 +1,36 @@
+/*
+ * bode.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_BODE_H_
+#define APP_INC_BODE_H_
+
+#include "adc.h"
+
+// TIM1 kernel clock (APB2)
+#define BODE_TIMER_FREQ 48000000
+
+// Default reference amplitude in hundredths of ADC code: AC peak of a full-scale sine (gain in dBFS)
+#define BODE_REF_DEFAULT (ADC_FULL_SCALE * 100 / 2)
+
+// One acquisition reduced to one line of the Bode table
+struct BODE_Row
+{
+	unsigned int frequency;		// hundredths of Hz
+	int gain;					// hundredths of dB, against the reference amplitude
+	unsigned int amplitude;		// hundredths of ADC code, AC peak in every mode: (max - min) / 2 of the windows
+								// (interpolated or not), of the averaged window, or lock-in amplitude
+	int phase;					// hundredths of degree (lock-in only)
+	unsigned char lockin;		// amplitude and phase from the lock-in integration
+	unsigned int thd;			// hundredths of % (THD measurement only)
+	unsigned char harmonics;	// bins of the THD, fundamental included (0 if not measured)
+	unsigned short n;			// periods used (dropped ones are left out)
+};
+
+unsigned char BODE_Reduce(struct BODE_Row* row, const unsigned short psc, const unsigned short divide_by, const unsigned short n_periods);
+void BODE_Set_Reference(const unsigned short amplitude);
+unsigned short BODE_Get_Reference(void);
+
+#endif /* APP_INC_BODE_H_ */
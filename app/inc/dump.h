@@ -0,0 +1,63 @@
+/*
+ * dump.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_DUMP_H_
+#define APP_INC_DUMP_H_
+
+#include <stdint.h>
+
+// Binary frame layout (little endian), decoded by tools/dump_decode.py:
+// magic[2] | block id | encoding | count (u16) | payload length (u16) | payload | checksum (sum of payload bytes)
+// Raw DMA frames have no checksum, the payload is followed by the trailer: magic[1] | magic[0] | block id
+#define DUMP_MAGIC_0 0xA5
+#define DUMP_MAGIC_1 0x5A
+#define DUMP_HEADER_SIZE 8
+#define DUMP_TRAILER_SIZE 3
+
+#define DUMP_BLOCK_TIMER_CNT 0x01
+#define DUMP_BLOCK_ADC_MAX 0x02
+#define DUMP_BLOCK_TRACE 0x03
+#define DUMP_BLOCK_PERIOD_TIME 0x04
+#define DUMP_BLOCK_AVERAGE 0x05
+// Spectrum levels, int16 hundredths of dBFS
+#define DUMP_BLOCK_SPECTRUM 0x06
+// Last block id, DMA frames have a header and a trailer per block
+#define DUMP_BLOCK_MAX DUMP_BLOCK_SPECTRUM
+
+// Frames of one DMA dump at most (timer, ADC max, period time, average and spectrum),
+// each one takes three queue entries
+#define DUMP_DMA_MAX_BLOCKS 5
+#define DUMP_DMA_ENTRIES_PER_BLOCK 3
+#define DUMP_DMA_QUEUE_ENTRIES (DUMP_DMA_ENTRIES_PER_BLOCK * DUMP_DMA_MAX_BLOCKS)
+
+#define DUMP_ENC_RAW16 0x00
+#define DUMP_ENC_DELTA_VARINT 0x01
+// Total records written (u32) followed by the 8 bytes records of trace.h
+#define DUMP_ENC_TRACE 0x02
+// 32-bit values: raw (DMA) or difference with the previous value (32-bit wrap) in a zigzag varint
+#define DUMP_ENC_RAW32 0x03
+#define DUMP_ENC_DELTA_VARINT32 0x04
+
+enum Dump_Mode
+{
+	DUMP_TEXT = 0,
+	DUMP_COMPRESSED,
+	DUMP_DMA,
+	DUMP_BODE,	// Bode table row only
+};
+
+uint32_t DUMP_Text_Size(const uint16_t* data, const uint32_t n);
+uint32_t DUMP_Delta_Varint_Size(const uint16_t* data, const uint32_t n);
+uint32_t DUMP_Delta_Varint_Send(const uint8_t block_id, const uint16_t* data, const uint32_t n);
+uint8_t DUMP_Raw_DMA_Queue(const uint8_t block_id, const uint16_t* data, const uint32_t n);
+uint32_t DUMP_Text32_Size(const uint32_t* data, const uint32_t n);
+uint32_t DUMP_Delta_Varint32_Send(const uint8_t block_id, const uint32_t* data, const uint32_t n);
+uint8_t DUMP_Raw32_DMA_Queue(const uint8_t block_id, const uint32_t* data, const uint32_t n);
+void DUMP_Frame_Begin(const uint8_t block_id, const uint8_t encoding, const uint32_t n, const uint32_t payload_size);
+uint8_t DUMP_Frame_Bytes(const void* data, const uint32_t size, uint8_t checksum);
+void DUMP_Frame_End(const uint8_t checksum);
+
+#endif /* APP_INC_DUMP_H_ */
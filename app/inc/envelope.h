@@ -0,0 +1,34 @@
+/*
+ * envelope.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_ENVELOPE_H_
+#define APP_INC_ENVELOPE_H_
+
+// Short runs, one per tested point
+#define ENV_N_PERIODS 32
+
+// Divide-by is doubled from 1 up to this value until a run has no overrun
+#define ENV_DIVIDE_BY_MAX 1024
+
+// ADC1->SMPR values 0..7
+#define ENV_N_SMPR 8
+
+// Lowest divide-by without overrun for one SMPR value, times in TIM2 cycles
+struct ENV_Result
+{
+	unsigned short divide_by;
+	unsigned char safe;			// 0 if still overrunning at ENV_DIVIDE_BY_MAX
+	unsigned char tested;
+	unsigned int slack_min;		// ADC re-armed to next TIM15 overflow
+	unsigned int busy;			// TIM15 overflow to ADC re-armed (= overflow period - slack)
+};
+
+void ENV_Start(void);
+unsigned char ENV_Run_Done(void);
+void ENV_Abort(void);
+const struct ENV_Result* ENV_Get_Result(const unsigned char smpr);
+
+#endif /* APP_INC_ENVELOPE_H_ */
@@ -0,0 +1,39 @@
+/*
+ * event.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_EVENT_H_
+#define APP_INC_EVENT_H_
+
+#include <stdint.h>
+
+// Lowest priority (see timer.h): the bottom half never delays capture and overflow interrupts
+#define PENDSV_INT_PRIORITY 3
+
+#define EVENT_QUEUE_SIZE 16
+
+enum Event_Id
+{
+	EVT_NONE = 0,
+	EVT_KEY,		// arg = key
+	EVT_RECORD,		// period records available in the record ring
+	EVT_ACQ_DONE,	// acquisition complete, arg = run id
+	EVT_ACQ_TIMEOUT,	// acquisition stopped (no signal), arg = run id
+};
+
+struct Event
+{
+	uint64_t time;				// when posted, cycles since boot (TICK_Get_Time())
+	unsigned char id;
+	unsigned char arg;
+};
+
+void EVENT_Init(void);
+void EVENT_Post(const unsigned char id, const unsigned char arg);
+unsigned char EVENT_Get(struct Event* evt);
+void EVENT_Wait(void);
+void EVENT_Pend_Bottom_Half(void);
+
+#endif /* APP_INC_EVENT_H_ */
@@ -0,0 +1,55 @@
+/*
+ * fft.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_FFT_H_
+#define APP_INC_FFT_H_
+
+#include <stdint.h>
+
+// Real FFT of one acquisition window (Hann): bins 0 to fs/2
+#define FFT_N 256
+#define FFT_N_BINS (FFT_N / 2 + 1)
+
+// Level of an empty bin (hundredths of dBFS)
+#define FFT_LEVEL_ZERO INT16_MIN
+
+// Work buffer of the bottom half (packed real FFT, re and im interleaved), the levels
+// (hundredths of dBFS) are written over it by FFT_Get_Result() once the run is over
+// Stored in acq_work (acq.h) with the sums of the bins
+union FFT_Buffer
+{
+	int16_t z[FFT_N];
+	int16_t level[FFT_N_BINS];
+};
+
+enum FFT_Mode
+{
+	FFT_OFF = 0,
+	FFT_AVERAGE,	// magnitudes averaged over the windows of the run
+	FFT_LAST,		// last window of the run only
+};
+
+struct FFT_Result
+{
+	unsigned int windows;		// windows in the spectrum
+	unsigned int peak_bin;		// largest bin above DC
+	int peak;					// hundredths of dBFS (full scale: sine of 512 codes peak)
+	unsigned int spur_bin;		// largest bin outside DC and the main lobe of the peak
+	int spur;					// hundredths of dBc
+	int floor;					// hundredths of dBFS, mean level of the other bins
+};
+
+void FFT_Set_Mode(const unsigned char mode);
+unsigned char FFT_Get_Mode(void);
+void FFT_Reset(void);
+void FFT_Window(void);
+unsigned char FFT_Get_Result(struct FFT_Result* result);
+
+#ifdef BENCH_FFT
+void FFT_Benchmark(void);
+#endif
+
+#endif /* APP_INC_FFT_H_ */
@@ -0,0 +1,50 @@
+/*
+ * fixmath.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_FIXMATH_H_
+#define APP_INC_FIXMATH_H_
+
+#include <stdint.h>
+
+// Q16: value * 65536
+#define FIX_Q16_ONE 65536
+
+// log10(2) in Q16
+#define FIX_LOG10_2 19728
+
+// Returned by FIX_Log10(0)
+#define FIX_LOG10_ZERO INT32_MIN
+
+// Q15 (value * 32768) and Q31 products
+#define FIX_MUL_Q15(a, b) ((int32_t) (((int32_t) (a) * (int32_t) (b)) >> 15))
+#define FIX_MUL_Q31(a, b) ((int32_t) (((int64_t) (a) * (int64_t) (b)) >> 31))
+
+// Angles: FIX_ANGLE_PI = pi rad, results in [-FIX_ANGLE_PI, FIX_ANGLE_PI)
+#define FIX_ANGLE_PI 32768
+#define FIX_ANGLE_TO_CENTIDEG(a) ((int32_t) (a) * 18000 / FIX_ANGLE_PI)
+
+// sin(2 pi i / 256) in Q15, indexed by the top 8 bits of a 32-bit phase (2^32 = one turn)
+#define FIX_SIN_TABLE_BITS 8
+#define FIX_SIN(phase) (fix_sin_table[(uint32_t) (phase) >> (32 - FIX_SIN_TABLE_BITS)])
+#define FIX_COS(phase) FIX_SIN((uint32_t) (phase) + 0x40000000)
+
+extern const int16_t fix_sin_table[1 << FIX_SIN_TABLE_BITS];
+
+int32_t FIX_Log10(const uint32_t x);
+int32_t FIX_dB(const uint32_t x, const uint32_t ref);
+void FIX_Polar(int32_t x, int32_t y, uint32_t* magnitude, int32_t* angle);
+int32_t FIX_Atan2(const int32_t y, const int32_t x);
+uint32_t FIX_Magnitude(const int32_t x, const int32_t y);
+void FIX_Sincos(const uint32_t phase, int32_t* c, int32_t* s);
+uint16_t FIX_Sqrt(uint32_t x);
+uint32_t FIX_Reciprocal(const uint32_t x, uint8_t* shift);
+uint32_t FIX_Div(const uint32_t num, const uint32_t den);
+
+#ifdef BENCH_FIXMATH
+void FIX_Benchmark(void);
+#endif
+
+#endif /* APP_INC_FIXMATH_H_ */
@@ -0,0 +1,29 @@
+/*
+ * lockin.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_LOCKIN_H_
+#define APP_INC_LOCKIN_H_
+
+#include <stdint.h>
+
+// Integrated I/Q over the windows of one run
+struct LOCKIN_Result
+{
+	unsigned int amplitude;		// hundredths of ADC code (peak)
+	int phase;					// FIX_ANGLE_PI = pi, against a sine starting at the PB14 edge of the window
+	unsigned int windows;		// windows integrated
+	unsigned int samples;		// samples integrated (whole signal periods of each window)
+	unsigned int rejected;		// windows shorter than one signal period, or signal above fs/2
+};
+
+void LOCKIN_Set_Enable(const unsigned char enable);
+unsigned char LOCKIN_Get_Enable(void);
+void LOCKIN_Reset(void);
+uint32_t LOCKIN_Phase_Step(const unsigned short capture);
+void LOCKIN_Window(const unsigned short capture);
+unsigned char LOCKIN_Get_Result(struct LOCKIN_Result* result);
+
+#endif /* APP_INC_LOCKIN_H_ */
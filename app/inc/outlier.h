@@ -0,0 +1,27 @@
+/*
+ * outlier.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_OUTLIER_H_
+#define APP_INC_OUTLIER_H_
+
+// Captures the gate compares against (odd, the median is the middle one)
+#define OUTLIER_WINDOW 7
+
+struct OUTLIER_Stats
+{
+	unsigned int checked;		// captures seen by the gate
+	unsigned int rejected;		// captures flagged as outliers
+	unsigned short median;		// of the last window, TIM1 counts
+	unsigned short mad;			// median absolute deviation of the last window
+};
+
+void OUTLIER_Set_Enable(const unsigned char enable);
+unsigned char OUTLIER_Get_Enable(void);
+void OUTLIER_Reset(void);
+unsigned char OUTLIER_Check(const unsigned short capture);
+void OUTLIER_Get_Stats(struct OUTLIER_Stats* stats);
+
+#endif /* APP_INC_OUTLIER_H_ */
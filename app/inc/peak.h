@@ -0,0 +1,30 @@
+/*
+ * peak.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_PEAK_H_
+#define APP_INC_PEAK_H_
+
+#include <stdint.h>
+
+// Interpolated amplitude in 1/16 of ADC code
+#define PEAK_SCALE 16
+
+// AC peak amplitude of the windows of one run, crest and trough between the samples
+struct PEAK_Result
+{
+	unsigned int amplitude;		// hundredths of ADC code, mean of (crest - trough) / 2
+	unsigned int windows;		// windows of the mean
+	unsigned int sine;			// windows fitted with the sine model (16 samples per period or less)
+};
+
+void PEAK_Set_Enable(const unsigned char enable);
+unsigned char PEAK_Get_Enable(void);
+void PEAK_Reset(void);
+uint32_t PEAK_Amplitude(const uint16_t* x, const uint32_t n, const uint32_t step);
+void PEAK_Window(const uint32_t step);
+unsigned char PEAK_Get_Result(struct PEAK_Result* result);
+
+#endif /* APP_INC_PEAK_H_ */
@@ -0,0 +1,38 @@
+/*
+ * record.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_RECORD_H_
+#define APP_INC_RECORD_H_
+
+#include <stdint.h>
+
+// Must be a power of two
+#define RECORD_RING_SIZE 64
+
+// Records were dropped before this one because the consumer fell behind
+#define RECORD_FLAG_GAP 0x0001
+// Periods were skipped before this one (overrun), and divide-by was raised by the overrun policy
+#define RECORD_FLAG_OVERRUN 0x0002
+#define RECORD_FLAG_DIVIDE_BY_RAISED 0x0004
+// Capture rejected by the outlier gate (glitch on PA8): left out of the results
+#define RECORD_FLAG_OUTLIER 0x0008
+
+// One record per signal period, capture and amplitude always come from the same period
+struct Period_Record
+{
+	uint64_t time;		// TIM1 capture interrupt, cycles since boot (TICK_Get_Time())
+	uint16_t capture;	// TIM1->CCR1
+	uint16_t amplitude;	// max of the ADC window
+	uint16_t seq;		// period number since start of acquisition
+	uint16_t flags;
+};
+
+void RECORD_Reset(void);
+uint8_t RECORD_Push(const struct Period_Record* rec);
+uint8_t RECORD_Pop(struct Period_Record* rec);
+uint32_t RECORD_Dropped(void);
+
+#endif /* APP_INC_RECORD_H_ */
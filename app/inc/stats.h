@@ -0,0 +1,48 @@
+/*
+ * stats.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_STATS_H_
+#define APP_INC_STATS_H_
+
+// TIM2 free-running at HCLK (see tick.h): 1 tick = 1 CPU cycle
+#define STATS_TIMER_FREQ 48000000
+
+// Bucket k holds durations in [2^k, 2^(k+1)) cycles, the last one everything above
+#define STATS_N_BUCKETS 20
+
+enum Stats_Id
+{
+	STATS_TIM1_CC_LATENCY = 0,	// TIM1 capture to TIM1_CC_IRQHandler entry
+	STATS_TIM15_LATENCY,		// TIM15 overflow (TRGO) to TIM15_IRQHandler entry
+	STATS_MAX_SEARCH,			// ADC_Find_Max_Value() (max and min) in the bottom half
+	STATS_REARM,				// ADC_Async_Arm() in the bottom half
+	STATS_CAPTURE_TO_ARM,		// capture ISR entry to ADC armed again
+	STATS_ARM_SLACK,			// ADC armed to next TIM15 overflow (missed ones are overruns)
+	STATS_LOCKIN,				// LOCKIN_Window() in the bottom half
+	STATS_AVERAGE,				// AVG_Window() in the bottom half
+	STATS_THD,					// THD_Window() in the bottom half
+	STATS_FFT,					// FFT_Window() in the bottom half
+	STATS_OUTLIER,				// OUTLIER_Check() in the capture ISR
+	STATS_PEAK,					// PEAK_Window() in the bottom half
+	STATS_N,
+};
+
+struct Stats_Histogram
+{
+	unsigned int count;
+	unsigned int min;
+	unsigned int max;
+	unsigned int bucket[STATS_N_BUCKETS];
+};
+
+void STATS_Init(void);
+void STATS_Clear(void);
+unsigned int STATS_Now(void);
+unsigned int STATS_Trigger_Time(void);
+void STATS_Add(const unsigned char id, const unsigned int cycles);
+const struct Stats_Histogram* STATS_Get(const unsigned char id);
+
+#endif /* APP_INC_STATS_H_ */
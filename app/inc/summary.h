@@ -0,0 +1,48 @@
+/*
+ * summary.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_SUMMARY_H_
+#define APP_INC_SUMMARY_H_
+
+#include <stdint.h>
+
+// Points of a sweep, stored in place of the raw result arrays (see acq.h)
+#define SUM_N_POINTS 256
+
+// Fixed-point scales of the stored statistics
+#define SUM_MEAN_SCALE 256
+#define SUM_STD_SCALE 16
+
+// Statistics of one run (sweep point), 28 bytes instead of 8 KB of raw arrays
+struct SUM_Point
+{
+	uint32_t period_mean;		// TIM1 counts * SUM_MEAN_SCALE
+	uint32_t amplitude_mean;	// ADC codes * SUM_MEAN_SCALE
+	uint16_t period_std;		// TIM1 counts * SUM_STD_SCALE (sample standard deviation)
+	uint16_t amplitude_std;		// ADC codes * SUM_STD_SCALE
+	uint16_t period_min;
+	uint16_t period_max;
+	uint16_t amplitude_min;
+	uint16_t amplitude_max;
+	uint16_t n;					// periods
+	uint16_t psc;				// settings of the run
+	uint16_t divide_by;
+	uint8_t smpr;
+	uint8_t flags;				// RECORD_FLAG_* of all the records
+};
+
+void SUM_Set_Enable(const uint8_t enable);
+uint8_t SUM_Get_Enable(void);
+void SUM_Clear(void);
+void SUM_Begin_Point(void);
+void SUM_Add(const uint16_t capture, const uint16_t amplitude, const uint16_t flags);
+uint8_t SUM_Converged(const uint16_t tolerance);
+uint8_t SUM_End_Point(void);
+uint32_t SUM_Get_N_Points(void);
+const struct SUM_Point* SUM_Get_Point(const uint32_t i);
+const struct SUM_Point* SUM_Get_Last(void);
+
+#endif /* APP_INC_SUMMARY_H_ */
@@ -0,0 +1,30 @@
+/*
+ * thd.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_THD_H_
+#define APP_INC_THD_H_
+
+// Goertzel bins at the fundamental and its harmonics 2 to THD_N_HARMONICS
+#define THD_N_HARMONICS 5
+
+// Harmonic distortion over the windows of one run
+struct THD_Result
+{
+	unsigned int thd;							// hundredths of %, sqrt(sum of harmonic powers) / fundamental
+	unsigned int amplitude[THD_N_HARMONICS];	// hundredths of ADC code (peak), [0] is the fundamental
+	int level[THD_N_HARMONICS];					// hundredths of dBc, INT32_MIN if the harmonic is zero
+	unsigned int harmonics;						// bins below fs/2 in every window, fundamental included
+	unsigned int windows;						// windows integrated
+	unsigned int rejected;						// windows shorter than one signal period, or signal above fs/2
+};
+
+void THD_Set_Enable(const unsigned char enable);
+unsigned char THD_Get_Enable(void);
+void THD_Reset(void);
+void THD_Window(const unsigned short capture);
+unsigned char THD_Get_Result(struct THD_Result* result);
+
+#endif /* APP_INC_THD_H_ */
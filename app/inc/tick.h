@@ -0,0 +1,28 @@
+/*
+ * tick.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_TICK_H_
+#define APP_INC_TICK_H_
+
+#include <stdint.h>
+
+// Same as PendSV: timeout checks never delay the acquisition interrupts
+#define TICK_INT_PRIORITY 3
+
+// SysTick runs from HCLK
+#define TICK_HCLK_FREQ 48000000
+#define TICK_FREQ 1000
+
+// Monotonic time: TIM2 free-running at HCLK, extended to 64 bits by SysTick
+#define TICK_TIME_FREQ 48000000
+
+void TICK_Init(void);
+void TICK_Process(void);
+unsigned int TICK_Get_Ms(void);
+uint64_t TICK_Get_Time(void);
+uint64_t TICK_Extend(const uint32_t cycles);
+
+#endif /* APP_INC_TICK_H_ */
@@ -8,8 +8,11 @@
 #ifndef APP_INC_TIMER_H_
 #define APP_INC_TIMER_H_
 
-#define TIM1_CC_INT_PRIORITY 10
-#define TIM15_OVF_INT_PRIORITY 9
+// NVIC priorities are 0 (highest) to 3, the Cortex-M0 keeps 2 bits:
+// 0 TIM15 overflow (ADC re-arm check), 1 TIM1 capture and ADC, 2 UART TX DMA,
+// 3 UART RX, USB, SysTick and PendSV (bottom half)
+#define TIM15_OVF_INT_PRIORITY 0
+#define TIM1_CC_INT_PRIORITY 1
 
 #define TIMER_CNT_SIZE 1024
 
@@ -18,7 +21,6 @@ void TIMER_IC_NVIC_Init(void);
 void TIMER_IC_ACQ_Enable(void);
 void TIMER_IC_ACQ_Disable(void);
 void TIMER_IC_Set_PSC(const unsigned short psc);
-void TIMER_IC_Data_Update(const unsigned short new_capture);
 
 void TIMER_FDIV_Init(void);
 void TIMER_FDIV_NVIC_Init(void);
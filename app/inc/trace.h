@@ -0,0 +1,57 @@
+/*
+ * trace.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_TRACE_H_
+#define APP_INC_TRACE_H_
+
+// Event trace, built with -DTRACE_ENABLE only: TRACE() compiles to nothing otherwise
+// Dumped as a binary frame (block DUMP_BLOCK_TRACE), decoded by tools/trace_decode.py
+
+// Number of records kept (power of 2), the oldest ones are overwritten
+#define TRACE_SIZE 128
+
+enum Trace_Id
+{
+	TRACE_NONE = 0,
+	TRACE_ACQ_START,		// arg = run id
+	TRACE_ACQ_ABORT,
+	TRACE_ACQ_TIMEOUT,		// arg = stage
+	TRACE_CAPTURE,			// arg = TIM1 capture
+	TRACE_CAPTURE_SKIPPED,
+	TRACE_TIM15_RELOAD,		// arg = divide-by
+	TRACE_OVERRUN,			// arg = record number
+	TRACE_ADC_READY,
+	TRACE_ADC_ARMED,
+	TRACE_ADC_WINDOW,		// DMA transfer complete, ADSTP set
+	TRACE_ADC_STOPPED,
+	TRACE_ADC_OFF,
+	TRACE_RECORD_PUSH,		// arg = record number
+	TRACE_RECORD_POP,		// arg = record number
+	TRACE_EVENT_POST,		// arg = event id << 8 | event arg
+	TRACE_EVENT_GET,		// arg = event id << 8 | event arg
+	TRACE_FAULT,
+};
+
+// 8 bytes, timestamp in TIM2 cycles (48MHz)
+struct Trace_Record
+{
+	unsigned int ts;
+	unsigned short id;
+	unsigned short arg;
+};
+
+#ifdef TRACE_ENABLE
+#define TRACE(id, arg) TRACE_Write((id), (arg))
+#else
+#define TRACE(id, arg)
+#endif
+
+void TRACE_Write(const unsigned short id, const unsigned short arg);
+void TRACE_Clear(void);
+unsigned int TRACE_Dump(void);
+void TRACE_Fault_Dump(void);
+
+#endif /* APP_INC_TRACE_H_ */
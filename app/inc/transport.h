@@ -0,0 +1,42 @@
+/*
+ * transport.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_TRANSPORT_H_
+#define APP_INC_TRANSPORT_H_
+
+// Output link used by stm32_printf and the dump path
+struct Transport
+{
+	const char* name;
+	// Blocking single byte output
+	void (*send_byte)(const unsigned char c);
+	// Queues a block read in place (zero-copy), returns 0 if it could not be queued
+	unsigned char (*queue)(const void* data, const unsigned short size);
+	// Non-zero while queued blocks are not sent yet
+	unsigned char (*busy)(void);
+	// Blocks that can still be queued
+	unsigned char (*space)(void);
+};
+
+extern const struct Transport transport_uart;
+extern const struct Transport transport_usb;
+
+#ifdef TRANSPORT_LOOPBACK
+// RAM backend for host tests: everything sent ends up in loopback_buf
+#define TRANSPORT_LOOPBACK_SIZE 4096
+extern const struct Transport transport_loopback;
+extern unsigned char loopback_buf[TRANSPORT_LOOPBACK_SIZE];
+extern unsigned int loopback_len;
+#endif
+
+void TRANSPORT_Select(const struct Transport* transport);
+const struct Transport* TRANSPORT_Get(void);
+void TRANSPORT_Send_Byte(const unsigned char c);
+unsigned char TRANSPORT_Queue(const void* data, const unsigned short size);
+unsigned char TRANSPORT_Busy(void);
+unsigned char TRANSPORT_Space(void);
+
+#endif /* APP_INC_TRANSPORT_H_ */
@@ -8,11 +8,26 @@
 #ifndef APP_INC_UART_H_
 #define APP_INC_UART_H_
 
-#define UART_RX_INT_PRIORITY 15
+// Below the capture path, see timer.h for the ordering
+#define UART_RX_INT_PRIORITY 3
+#define UART_DMA_INT_PRIORITY 2
+
+// Number of blocks that can be queued for DMA transmission, one slot stays empty:
+// a whole DMA dump (header, data and trailer of DUMP_DMA_MAX_BLOCKS frames) fits
+#define UART_DMA_QUEUE_SIZE 16
 
 void UART_Init(void);
 void UART_NVIC_Init(void);
 void UART_RXINT_Enable(void);
 void UART_RXINT_Disable(void);
+void UART_Send_Byte(const unsigned char c);
+
+void UART_DMA_Init(void);
+void UART_DMA_NVIC_Init(void);
+unsigned char UART_DMA_Queue(const void* data, const unsigned short size);
+unsigned char UART_DMA_Space(void);
+unsigned char UART_DMA_Busy(void);
+void UART_DMA_Abort(void);
+void UART_DMA_TX_Complete(void);
 
 #endif /* APP_INC_UART_H_ */
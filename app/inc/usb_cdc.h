@@ -0,0 +1,32 @@
+/*
+ * usb_cdc.h
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#ifndef APP_INC_USB_CDC_H_
+#define APP_INC_USB_CDC_H_
+
+#define USB_INT_PRIORITY 3
+
+// Full-speed packet size for control and bulk endpoints
+#define USB_CDC_PACKET_SIZE 64
+
+// Number of blocks that can be queued for transmission, one slot stays empty:
+// a whole DMA dump (header, data and trailer of DUMP_DMA_MAX_BLOCKS frames) fits
+#define USB_CDC_QUEUE_SIZE 16
+
+// Received bytes not yet read by the application
+#define USB_CDC_RX_BUFFER_SIZE 64
+
+void USB_CDC_Init(void);
+void USB_CDC_NVIC_Init(void);
+void USB_CDC_IRQ_Process(void);
+unsigned char USB_CDC_Connected(void);
+void USB_CDC_Send_Byte(const unsigned char c);
+unsigned char USB_CDC_Queue(const void* data, const unsigned short size);
+unsigned char USB_CDC_Space(void);
+unsigned char USB_CDC_Busy(void);
+unsigned char USB_CDC_Read_Byte(unsigned char* c);
+
+#endif /* APP_INC_USB_CDC_H_ */
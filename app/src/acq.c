@@ -0,0 +1,616 @@
+/*
+ * acq.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "acq.h"
+#include "adc.h"
+#include "timer.h"
+#include "event.h"
+#include "record.h"
+#include "tick.h"
+#include "stats.h"
+#include "trace.h"
+#include "lockin.h"
+#include "average.h"
+#include "thd.h"
+#include "fft.h"
+#include "outlier.h"
+#include "peak.h"
+#include "fixmath.h"
+#include "stm32f0xx.h"
+
+// Filled from period records
+union ACQ_Results acq_results;
+
+// Averaging or spectrum of the windows
+union ACQ_Work acq_work;
+
+// declared in timer.c
+extern uint16_t previous_divide_by;
+extern volatile uint32_t fdiv_overflow_count;
+
+// All the state of one acquisition run, cleared by ACQ_Reset()
+struct ACQ_Context
+{
+	uint8_t run_id;		// incremented by every start, tells events of an aborted run apart
+
+	// Producer side (capture ISR, DMA interrupt and bottom half)
+	volatile uint8_t running;
+	volatile uint8_t signal_check;		// ADC not armed yet, TIM15 input is being checked
+	volatile uint8_t capture_filled;	// set by TIM1 capture ISR, last_capture is valid
+	volatile uint8_t window_filled;		// set by DMA1 CH1 interrupt, window of the period is in adc_acq_data
+	volatile uint16_t last_capture;
+	volatile uint8_t capture_outlier;	// last_capture rejected by the outlier gate
+	volatile uint64_t last_capture_time;	// cycles since boot
+	uint16_t period_seq;
+	uint32_t trough_sum;		// sum of the window minimums (outliers excluded)
+	uint32_t trough_windows;
+	uint64_t start_time;
+
+	// Timing statistics (TIM2 cycles)
+	volatile uint32_t capture_time;
+	volatile uint32_t arm_time;
+	volatile uint8_t arm_timed;		// arm_time not used by a trigger yet
+	uint32_t last_trigger_time;
+	uint8_t trigger_timed;			// last_trigger_time is valid
+	struct ACQ_Timing timing;
+
+	// Overrun policy: a period whose window could not be re-armed in time is skipped
+	volatile uint8_t skip_capture;
+	volatile uint16_t overrun_flags;
+	uint32_t overrun_since_raise;
+	struct ACQ_Overrun_Stats overrun_stats;
+
+	// Timeouts (SysTick)
+	volatile uint32_t progress_ms;		// last window, capture or record
+	uint32_t timeout_ms;
+	uint32_t signal_counts;				// TIM15 input periods when the check started
+	uint8_t timeout_stage;
+
+	// Consumer side (main loop)
+	uint32_t records_received;
+	uint8_t aborted;
+	uint8_t converged;		// stopped early by the tolerance
+};
+
+static struct ACQ_Context acq_ctx;
+
+// Kept across runs
+static uint8_t auto_divide = 0;
+static uint16_t n_periods = ACQ_N_PERIODS;
+static uint16_t tolerance = 0;
+static uint16_t min_periods = ACQ_MIN_PERIODS_DEFAULT;
+
+static void ACQ_Window_Done(void)
+{
+	// Called from DMA1 CH1 interrupt, the window may complete after the capture
+	acq_ctx.window_filled = 1;
+	acq_ctx.progress_ms = TICK_Get_Ms();
+	EVENT_Pend_Bottom_Half();
+}
+
+static void ACQ_ADC_Off(void)
+{
+	// Called once the ADC is disabled at the end of the run
+	EVENT_Post(EVT_ACQ_DONE, acq_ctx.run_id);
+}
+
+static uint32_t ACQ_Signal_Counts(void)
+{
+	// Input periods counted by TIM15 so far. The overflow ISR reloads the counter and counts
+	// the overflow: both are read again if it ran in between
+	uint32_t overflows;
+	uint16_t cnt;
+	do
+	{
+		overflows = fdiv_overflow_count;
+		cnt = TIM15->CNT;
+	} while (overflows != fdiv_overflow_count);
+
+	// Counts since the reload value, past divide-by while the overflow ISR is still pending
+	const uint16_t position = (uint16_t) (cnt + previous_divide_by + 1);
+	return overflows * (previous_divide_by + 1) + position;
+}
+
+static void ACQ_Reset(struct ACQ_Context* ctx)
+{
+	ctx->running = 0;
+	ctx->capture_filled = 0;
+	ctx->window_filled = 0;
+	ctx->last_capture = 0;
+	ctx->capture_outlier = 0;
+	ctx->period_seq = 0;
+	ctx->trough_sum = 0;
+	ctx->trough_windows = 0;
+
+	ctx->skip_capture = 0;
+	ctx->overrun_flags = 0;
+	ctx->overrun_since_raise = 0;
+	ctx->overrun_stats.count = 0;
+	ctx->overrun_stats.divide_by_start = previous_divide_by;
+	ctx->overrun_stats.divide_by_end = previous_divide_by;
+	ctx->overrun_stats.raised_at = ACQ_N_PERIODS;
+
+	ctx->arm_timed = 0;
+	ctx->trigger_timed = 0;
+	ctx->timing.slack_min = 0xFFFFFFFF;
+	ctx->timing.trigger_period = 0;
+
+	ctx->signal_check = 0;
+	ctx->progress_ms = TICK_Get_Ms();
+	ctx->timeout_ms = ACQ_TIMEOUT_MAX_MS;
+	ctx->timeout_stage = ACQ_STAGE_NONE;
+
+	ctx->records_received = 0;
+	ctx->aborted = 0;
+	ctx->converged = 0;
+}
+
+static void ACQ_Stop(struct ACQ_Context* ctx)
+{
+	// Masked so the capture, DMA and bottom half see either the running or the stopped run
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	ctx->running = 0;
+	ctx->capture_filled = 0;
+	ctx->window_filled = 0;
+
+	TIMER_IC_ACQ_Disable();
+
+	// Aborts the window, ADC shuts down in the background (no EVT_ACQ_DONE)
+	ADC_Async_Disable(0);
+
+	__set_PRIMASK(primask);
+}
+
+static void ACQ_Timeout(struct ACQ_Context* ctx, const uint8_t stage)
+{
+	ctx->timeout_stage = stage;
+	TRACE(TRACE_ACQ_TIMEOUT, stage);
+	ACQ_Stop(ctx);
+	EVENT_Post(EVT_ACQ_TIMEOUT, ctx->run_id);
+}
+
+void ACQ_Start(void)
+{
+	// Running statistics for the early stop, and the point of summary mode
+	SUM_Begin_Point();
+
+	if (!SUM_Get_Enable())
+	{
+		// Result arrays hold zero for periods whose record was dropped
+		for (uint32_t i = 0; i < ACQ_N_PERIODS; ++i)
+		{
+			acq_results.timer_cnt[i] = 0;
+			acq_results.adc_max_data[i] = 0;
+			acq_results.period_time[i] = 0;
+		}
+	}
+
+	// Producer is stopped: records of an aborted run are discarded
+	RECORD_Reset();
+	ACQ_Reset(&acq_ctx);
+	LOCKIN_Reset();
+	AVG_Reset();
+	THD_Reset();
+	FFT_Reset();
+	OUTLIER_Reset();
+	PEAK_Reset();
+	++acq_ctx.run_id;
+	acq_ctx.start_time = TICK_Get_Time();
+
+#ifdef TRACE_ENABLE
+	// Trace of this run only
+	TRACE_Clear();
+#endif
+	TRACE(TRACE_ACQ_START, acq_ctx.run_id);
+
+	// Clear LD2 (overrun indicator)
+	GPIOA->ODR &= ~GPIO_ODR_5;
+
+	// ADC is armed by ACQ_Tick() once the TIM15 input is seen counting
+	acq_ctx.signal_counts = ACQ_Signal_Counts();
+	acq_ctx.signal_check = 1;
+	acq_ctx.running = 1;
+	TIMER_IC_ACQ_Enable();
+}
+
+void ACQ_Abort(void)
+{
+	__disable_irq();
+
+	if (acq_ctx.running)
+	{
+		acq_ctx.aborted = 1;
+		TRACE(TRACE_ACQ_ABORT, acq_ctx.period_seq);
+		ACQ_Stop(&acq_ctx);
+	}
+
+	__enable_irq();
+}
+
+void ACQ_Finish(void)
+{
+	// Ends the run like the last period does: the ADC is disabled, then EVT_ACQ_DONE
+	// Masked so the bottom half cannot re-arm the ADC in between
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	if (acq_ctx.running && !acq_ctx.signal_check)
+	{
+		acq_ctx.running = 0;
+		acq_ctx.capture_filled = 0;
+		acq_ctx.window_filled = 0;
+		TIMER_IC_ACQ_Disable();
+		ADC_Async_Disable(ACQ_ADC_Off);
+	}
+
+	__set_PRIMASK(primask);
+}
+
+void ACQ_Tick(void)
+{
+	// Called from SysTick_Handler every ms, same priority as the bottom half
+	struct ACQ_Context* ctx = &acq_ctx;
+
+	if (!ctx->running) return;
+
+	const uint32_t elapsed = TICK_Get_Ms() - ctx->progress_ms;
+
+	if (ctx->signal_check)
+	{
+		if (elapsed < ACQ_SIGNAL_CHECK_MS) return;
+
+		// Input periods counted by TIM15 during the check: slow inputs take more than
+		// ACQ_SIGNAL_CHECK_MS, the check goes on up to the stage timeout
+		const uint32_t counts = ACQ_Signal_Counts() - ctx->signal_counts;
+
+		// Two edges bound the input period: elapsed / (counts - 1) at most
+		if (counts < 2)
+		{
+			if (elapsed >= ACQ_TIMEOUT_MAX_MS) ACQ_Timeout(ctx, ACQ_STAGE_SIGNAL);
+			return;
+		}
+
+		// Time of one window period from the measured input rate, with some margin
+		uint32_t timeout = (uint32_t) ACQ_TIMEOUT_PERIODS * elapsed * (previous_divide_by + 1) / (counts - 1);
+		timeout += ACQ_TIMEOUT_MARGIN_MS;
+		ctx->timeout_ms = (timeout < ACQ_TIMEOUT_MAX_MS) ? timeout : ACQ_TIMEOUT_MAX_MS;
+
+		ctx->progress_ms = TICK_Get_Ms();
+		ctx->signal_check = 0;
+		ADC_Async_Arm(ACQ_Window_Done);
+		ctx->arm_time = STATS_Now();
+		ctx->arm_timed = 1;
+	}
+	else if (elapsed >= ctx->timeout_ms)
+	{
+		// Window needs TIM15 overflow (PB14), record needs TIM1 capture (PA8)
+		ACQ_Timeout(ctx, ctx->window_filled ? ACQ_STAGE_CAPTURE : ACQ_STAGE_WINDOW);
+	}
+}
+
+void ACQ_Restart(const struct ACQ_Settings* settings)
+{
+	// A bad configuration only costs the periods acquired so far
+	ACQ_Abort();
+	ACQ_Apply_Settings(settings);
+	ACQ_Start();
+}
+
+void ACQ_Apply_Settings(const struct ACQ_Settings* settings)
+{
+	// Between runs only
+	TIMER_IC_Set_PSC(settings->psc);
+	TIMER_FDIV_Set_CNT(settings->divide_by);
+	auto_divide = settings->auto_divide;
+	n_periods = (settings->n_periods > 0 && settings->n_periods <= ACQ_N_PERIODS) ? settings->n_periods : ACQ_N_PERIODS;
+	tolerance = settings->tolerance;
+	min_periods = (settings->min_periods >= 2) ? settings->min_periods : 2;
+
+	// Written at the end of the ADC stop, before the ADC is armed again
+	ADC_Async_Set_SMPR(settings->smpr, 0);
+}
+
+void ACQ_Get_Settings(struct ACQ_Settings* settings)
+{
+	settings->psc = TIM1->PSC + 1;
+	settings->divide_by = previous_divide_by;
+	settings->n_periods = n_periods;
+	settings->tolerance = tolerance;
+	settings->min_periods = min_periods;
+	settings->smpr = ADC1->SMPR & ADC_SMPR_SMP_Msk;
+	settings->auto_divide = auto_divide;
+}
+
+void ACQ_Capture(const uint16_t capture)
+{
+	// Called from TIM1 capture ISR at the end of the ADC window
+	if (!acq_ctx.running || acq_ctx.signal_check) return;
+
+	if (acq_ctx.skip_capture)
+	{
+		// Capture of a skipped period: its window was never acquired
+		acq_ctx.skip_capture = 0;
+		TRACE(TRACE_CAPTURE_SKIPPED, capture);
+		return;
+	}
+
+	TRACE(TRACE_CAPTURE, capture);
+	acq_ctx.capture_time = STATS_Now();
+
+	if (OUTLIER_Get_Enable())
+	{
+		// Glitches on PA8, judged against the last captures at full rate
+		acq_ctx.capture_outlier = OUTLIER_Check(capture);
+		STATS_Add(STATS_OUTLIER, STATS_Now() - acq_ctx.capture_time);
+	}
+
+	acq_ctx.last_capture_time = TICK_Extend(acq_ctx.capture_time);
+	acq_ctx.last_capture = capture;
+	acq_ctx.capture_filled = 1;
+	acq_ctx.progress_ms = TICK_Get_Ms();
+	EVENT_Pend_Bottom_Half();
+}
+
+void ACQ_Bottom_Half(void)
+{
+	// Runs from PendSV, right after the capture ISR (tail-chained),
+	// preempted by capture and overflow interrupts but never by the main loop
+	struct ACQ_Context* ctx = &acq_ctx;
+
+	if (ctx->running && ctx->capture_filled && ctx->window_filled)
+	{
+		struct Period_Record rec;
+
+		// Capture and amplitude of the same period go in one record
+		rec.time = ctx->last_capture_time;
+		rec.capture = ctx->last_capture;
+		rec.seq = ctx->period_seq++;
+		rec.flags = ctx->overrun_flags;
+		ctx->overrun_flags = 0;
+		if (ctx->capture_outlier)
+		{
+			rec.flags |= RECORD_FLAG_OUTLIER;
+			ctx->capture_outlier = 0;
+		}
+
+		// ADC was already stopped by the DMA interrupt: calculate max ADC value,
+		// the minimum takes the DC level out of the Bode amplitude
+		const uint32_t t_search = STATS_Now();
+		uint16_t trough;
+		rec.amplitude = ADC_Find_Max_Value(&trough);
+		ctx->window_filled = 0;
+		STATS_Add(STATS_MAX_SEARCH, STATS_Now() - t_search);
+		if (!(rec.flags & RECORD_FLAG_OUTLIER))
+		{
+			ctx->trough_sum += trough;
+			++ctx->trough_windows;
+		}
+
+		if (PEAK_Get_Enable())
+		{
+			// Crest between the samples, the sine model needs the period of this window
+			const uint32_t t_peak = STATS_Now();
+			PEAK_Window((rec.flags & RECORD_FLAG_OUTLIER) ? 0 : LOCKIN_Phase_Step(rec.capture));
+			STATS_Add(STATS_PEAK, STATS_Now() - t_peak);
+		}
+
+		// The window is fine, the period of an outlier capture is not
+		if (LOCKIN_Get_Enable() && !(rec.flags & RECORD_FLAG_OUTLIER))
+		{
+			// I/Q integration, before the window is overwritten by the next one
+			const uint32_t t_lockin = STATS_Now();
+			LOCKIN_Window(rec.capture);
+			STATS_Add(STATS_LOCKIN, STATS_Now() - t_lockin);
+		}
+
+		if (AVG_Get_Enable())
+		{
+			// Coherent sum of the windows
+			const uint32_t t_average = STATS_Now();
+			AVG_Window();
+			STATS_Add(STATS_AVERAGE, STATS_Now() - t_average);
+		}
+
+		if (THD_Get_Enable() && !(rec.flags & RECORD_FLAG_OUTLIER))
+		{
+			// Goertzel bins of the fundamental and its harmonics
+			const uint32_t t_thd = STATS_Now();
+			THD_Window(rec.capture);
+			STATS_Add(STATS_THD, STATS_Now() - t_thd);
+		}
+
+		if (FFT_Get_Mode() != FFT_OFF)
+		{
+			// Magnitude spectrum of the window
+			const uint32_t t_fft = STATS_Now();
+			FFT_Window();
+			STATS_Add(STATS_FFT, STATS_Now() - t_fft);
+		}
+
+		RECORD_Push(&rec);
+		TRACE(TRACE_RECORD_PUSH, rec.seq);
+		ctx->progress_ms = TICK_Get_Ms();
+
+		// Clear flag before re-arming: a TIM15 overflow right after the ADC is armed
+		// starts a real window and must not be seen as an overrun
+		ctx->capture_filled = 0;
+
+		if (ctx->period_seq < n_periods)
+		{
+			// Re-arm ADC for next samples (finishes in interrupt if ADSTP is still in progress)
+			const uint32_t t_arm = STATS_Now();
+			ADC_Async_Arm(ACQ_Window_Done);
+			ctx->arm_time = STATS_Now();
+			ctx->arm_timed = 1;
+			STATS_Add(STATS_REARM, ctx->arm_time - t_arm);
+			STATS_Add(STATS_CAPTURE_TO_ARM, ctx->arm_time - ctx->capture_time);
+		}
+		else
+		{
+			// EVT_ACQ_DONE is posted once the ADC is disabled
+			ctx->running = 0;
+			TIMER_IC_ACQ_Disable();
+			ADC_Async_Disable(ACQ_ADC_Off);
+		}
+	}
+}
+
+uint32_t ACQ_Consume(void)
+{
+	// Main loop side: drain the record ring into the result arrays
+	struct Period_Record rec;
+	uint32_t n = 0;
+
+	while (RECORD_Pop(&rec))
+	{
+		TRACE(TRACE_RECORD_POP, rec.seq);
+		SUM_Add(rec.capture, rec.amplitude, rec.flags);
+		// Outliers are left at zero like dropped records
+		if (!SUM_Get_Enable() && rec.seq < ACQ_N_PERIODS && !(rec.flags & RECORD_FLAG_OUTLIER))
+		{
+			acq_results.timer_cnt[rec.seq] = rec.capture;
+			acq_results.adc_max_data[rec.seq] = rec.amplitude;
+			// Ticks / 16 fit in 32 bits for 24 min at 48 MHz, then FIX_Div() by 3: no 64-bit division
+			_Static_assert(TICK_TIME_FREQ % 16000000 == 0, "whole number of 16 ticks per us");
+			const uint64_t ticks = rec.time - acq_ctx.start_time;
+			const uint32_t ticks_16 = (ticks >> 36) ? 0xFFFFFFFF : (uint32_t) (ticks >> 4);
+			acq_results.period_time[rec.seq] = FIX_Div(ticks_16, TICK_TIME_FREQ / 16000000);
+		}
+		++n;
+	}
+
+	acq_ctx.records_received += n;
+
+	// Early stop: the remaining periods would not change the means by more than the tolerance
+	if (n && tolerance && acq_ctx.running && !acq_ctx.converged
+		&& acq_ctx.records_received >= min_periods && SUM_Converged(tolerance))
+	{
+		acq_ctx.converged = 1;
+		ACQ_Finish();
+	}
+	return n;
+}
+
+uint32_t ACQ_Get_Trough(void)
+{
+	// Main loop, once the run is over: mean minimum of the windows in hundredths of ADC code
+	if (acq_ctx.trough_windows == 0) return 0;
+	return FIX_Div(acq_ctx.trough_sum * 100 + acq_ctx.trough_windows / 2, acq_ctx.trough_windows);
+}
+
+inline uint32_t ACQ_Records_Received(void)
+{
+	return acq_ctx.records_received;
+}
+
+inline uint64_t ACQ_Start_Time(void)
+{
+	return acq_ctx.start_time;
+}
+
+inline uint8_t ACQ_Run_Id(void)
+{
+	return acq_ctx.run_id;
+}
+
+inline uint8_t ACQ_Running(void)
+{
+	return acq_ctx.running;
+}
+
+inline uint8_t ACQ_Aborted(void)
+{
+	return acq_ctx.aborted;
+}
+
+inline uint8_t ACQ_Converged(void)
+{
+	return acq_ctx.converged;
+}
+
+uint8_t ACQ_Trigger_Missed(const uint32_t trigger_time)
+{
+	// Called from TIM15 overflow ISR: this TRGO only starts a window if the previous one
+	// was processed and the ADC is armed again
+	if (!acq_ctx.running || acq_ctx.signal_check) return 0;
+
+	if (acq_ctx.trigger_timed)
+	{
+		acq_ctx.timing.trigger_period = trigger_time - acq_ctx.last_trigger_time;
+	}
+	acq_ctx.last_trigger_time = trigger_time;
+	acq_ctx.trigger_timed = 1;
+
+	if (acq_ctx.capture_filled || ADC_Get_State() != ADC_STATE_ARMED) return 1;
+
+	// Margin left before this trigger would have been missed
+	if (acq_ctx.arm_timed)
+	{
+		const uint32_t slack = trigger_time - acq_ctx.arm_time;
+		STATS_Add(STATS_ARM_SLACK, slack);
+		if (slack < acq_ctx.timing.slack_min) acq_ctx.timing.slack_min = slack;
+		acq_ctx.arm_timed = 0;
+	}
+	return 0;
+}
+
+void ACQ_Overrun(void)
+{
+	// Called from TIM15 overflow ISR when the previous window is still being processed:
+	// the ADC misses this trigger, so the capture of this period is ignored
+	struct ACQ_Context* ctx = &acq_ctx;
+
+	ctx->skip_capture = 1;
+	ctx->overrun_flags |= RECORD_FLAG_OVERRUN;
+	TRACE(TRACE_OVERRUN, ctx->period_seq);
+
+	if (ctx->overrun_stats.count < ACQ_OVERRUN_LOG_SIZE)
+	{
+		ctx->overrun_stats.log[ctx->overrun_stats.count] = ctx->period_seq;
+	}
+	++ctx->overrun_stats.count;
+
+	// Automatic load reduction: fewer windows per second
+	if (auto_divide && ++ctx->overrun_since_raise >= ACQ_OVERRUN_RAISE_AFTER && previous_divide_by <= 0x7FFF)
+	{
+		// Used by the next counter reload, the next record spans twice as many input periods
+		if (ctx->overrun_stats.divide_by_end == ctx->overrun_stats.divide_by_start)
+		{
+			ctx->overrun_stats.raised_at = ctx->period_seq;
+		}
+		previous_divide_by *= 2;
+		ctx->overrun_stats.divide_by_end = previous_divide_by;
+		ctx->overrun_flags |= RECORD_FLAG_DIVIDE_BY_RAISED;
+		ctx->overrun_since_raise = 0;
+	}
+}
+
+inline uint8_t ACQ_Timeout_Stage(void)
+{
+	return acq_ctx.timeout_stage;
+}
+
+inline void ACQ_Set_Auto_Divide(const uint8_t enable)
+{
+	auto_divide = enable;
+}
+
+inline uint8_t ACQ_Get_Auto_Divide(void)
+{
+	return auto_divide;
+}
+
+inline const struct ACQ_Timing* ACQ_Get_Timing(void)
+{
+	return &acq_ctx.timing;
+}
+
+inline const struct ACQ_Overrun_Stats* ACQ_Get_Overrun_Stats(void)
+{
+	return &acq_ctx.overrun_stats;
+}
@@ -6,13 +6,34 @@
  */
 
 #include "adc.h"
+#include "trace.h"
 #include "stm32f0xx.h"
 
-// data buffer
-uint16_t adc_max_data[ADC_MAX_DATA_SIZE] = {0};
 // This buffer contains the digitized half sine wave, and should not be totally filled up
 uint16_t adc_acq_data[ADC_ACQ_DATA_SIZE] = {0};
 
+// Requests that wait for the ADC to be idle
+#define ADC_PENDING_ARM		0x1
+#define ADC_PENDING_DISABLE	0x2
+#define ADC_PENDING_SMPR	0x4
+
+// Callbacks of the requests completed by one step (window, SMPR, disable)
+#define ADC_DONE_MAX 3
+
+struct ADC_Done
+{
+	ADC_Callback cb[ADC_DONE_MAX];
+	uint8_t n;
+};
+
+// Changed from thread mode, PendSV and ADC interrupts, always with interrupts masked
+static volatile uint8_t adc_state = ADC_STATE_OFF;
+static volatile uint8_t adc_pending = 0;
+static uint8_t pending_smpr = 0;
+static ADC_Callback adc_window_done = 0;
+static ADC_Callback disable_done = 0;
+static ADC_Callback smpr_done = 0;
+
 void ADC_Init(void)
 {
 	// ADC input: PB0 (ADC_IN8)
@@ -101,75 +122,292 @@ void ADC_Init(void)
 
 	// Enable DMA requests
 	ADC1->CFGR1 |= ADC_CFGR1_DMAEN;
+
+	// Enable ADC ready interrupt (end of enable request)
+	ADC1->IER = ADC_IER_ADRDYIE;
+
+	// Enable DMA transfer complete interrupt (end of window)
+	DMA1_Channel1->CCR |= DMA_CCR_TCIE;
+
+///////////////////////////////////////////////////////// TIM6 Config
+
+	// Enable TIM6 clock
+	RCC->APB1ENR |= RCC_APB1ENR_TIM6EN;
+
+	// One-shot delay to check ADSTP and ADDIS again, counting us
+	TIM6->CR1 = TIM_CR1_OPM | TIM_CR1_URS;
+	TIM6->PSC = (uint16_t) 48 -1;
+	TIM6->ARR = (uint16_t) ADC_POLL_DELAY_US;
+
+	// Load prescaler (no interrupt with URS set)
+	TIM6->EGR = TIM_EGR_UG;
+
+	// Enable update interrupt
+	TIM6->DIER = TIM_DIER_UIE;
 }
 
-void ADC_ACQ_Enable(void)
+void ADC_NVIC_Init(void)
 {
-	// Set number of data register (= size of adc_data)
-	DMA1_Channel1->CNDTR = (uint16_t) ADC_ACQ_DATA_SIZE;
+	NVIC_SetPriority(DMA1_Channel1_IRQn, ADC_INT_PRIORITY);
+	NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+
+	NVIC_SetPriority(ADC1_COMP_IRQn, ADC_INT_PRIORITY);
+	NVIC_EnableIRQ(ADC1_COMP_IRQn);
 
-	// Enable DMA CH1 for ADC
+	NVIC_SetPriority(TIM6_DAC_IRQn, ADC_INT_PRIORITY);
+	NVIC_EnableIRQ(TIM6_DAC_IRQn);
+}
+
+static void ADC_Done_Add(struct ADC_Done* d, ADC_Callback cb)
+{
+	if (cb != 0 && d->n < ADC_DONE_MAX)
+	{
+		d->cb[d->n++] = cb;
+	}
+}
+
+static void ADC_Done_Run(const struct ADC_Done* d)
+{
+	for (uint32_t i = 0; i < d->n; ++i)
+	{
+		d->cb[i]();
+	}
+}
+
+static void ADC_Arm_Now(void)
+{
+	// Reload DMA for a new window
+	DMA1_Channel1->CCR &= ~DMA_CCR_EN;
+	DMA1->IFCR = DMA_IFCR_CGIF1;
+	DMA1_Channel1->CNDTR = (uint16_t) ADC_ACQ_DATA_SIZE;
 	DMA1_Channel1->CCR |= DMA_CCR_EN;
 
-	// Enable ADC
-	ADC1->CR |= ADC_CR_ADEN;
+	// Overrun from the conversion after the last window would block DMA requests
+	ADC1->ISR = ADC_ISR_OVR | ADC_ISR_EOSMP | ADC_ISR_EOC | ADC_ISR_EOS;
 
 	// Start conversion (on trigger)
 	ADC1->CR |= ADC_CR_ADSTART;
+	adc_state = ADC_STATE_ARMED;
+	TRACE(TRACE_ADC_ARMED, 0);
 }
 
-void ADC_ACQ_Disable(void)
+static void ADC_Enable_Now(void)
 {
-	// wait for DMA to be done with ADC (should be done at the same time)
-	while((DMA1->ISR & DMA_ISR_TCIF1) != DMA_ISR_TCIF1);
+	// ADRDY interrupt completes the request
+	ADC1->ISR = ADC_ISR_ADRDY;
+	ADC1->CR |= ADC_CR_ADEN;
+	adc_state = ADC_STATE_ENABLING;
+}
 
-	// Stop ADC conversion
-	ADC1->CR |= ADC_CR_ADSTP;
-	while((ADC1->CR & ADC_CR_ADSTP) == ADC_CR_ADSTP);
+static void ADC_Step(struct ADC_Done* d)
+{
+	// One state machine step, called with interrupts masked: nothing here waits for the hardware
 
-	// Stop ADC
-	ADC1->CR |= ADC_CR_ADDIS;
-	while((ADC1->CR & ADC_CR_ADDIS) == ADC_CR_ADDIS);
+	// Operations without completion interrupt
+	if (adc_state == ADC_STATE_STOPPING && (ADC1->CR & ADC_CR_ADSTP) == 0)
+	{
+		adc_state = ADC_STATE_READY;
+		TRACE(TRACE_ADC_STOPPED, 0);
+	}
+	else if (adc_state == ADC_STATE_DISABLING && (ADC1->CR & ADC_CR_ADEN) == 0)
+	{
+		adc_state = ADC_STATE_OFF;
+		TRACE(TRACE_ADC_OFF, 0);
 
-	// Disable DMA for ADC requests
-	DMA1_Channel1->CCR &= ~DMA_CCR_EN;
+		// Disable DMA for ADC requests
+		DMA1_Channel1->CCR &= ~DMA_CCR_EN;
+
+		ADC_Done_Add(d, disable_done);
+		disable_done = 0;
+	}
+
+	// SMPR can be written whenever no conversion is ongoing
+	if ((adc_pending & ADC_PENDING_SMPR) && (adc_state == ADC_STATE_OFF || adc_state == ADC_STATE_READY))
+	{
+		ADC1->SMPR = pending_smpr;
+		adc_pending &= ~ADC_PENDING_SMPR;
+		ADC_Done_Add(d, smpr_done);
+		smpr_done = 0;
+	}
+
+	// Requests waiting for the ADC to be idle (only the latest of arm and disable is kept)
+	if (adc_state == ADC_STATE_READY)
+	{
+		if (adc_pending & ADC_PENDING_DISABLE)
+		{
+			adc_pending &= ~ADC_PENDING_DISABLE;
+			ADC1->CR |= ADC_CR_ADDIS;
+			adc_state = ADC_STATE_DISABLING;
+		}
+		else if (adc_pending & ADC_PENDING_ARM)
+		{
+			adc_pending &= ~ADC_PENDING_ARM;
+			ADC_Arm_Now();
+		}
+	}
+	else if (adc_state == ADC_STATE_OFF && (adc_pending & ADC_PENDING_ARM))
+	{
+		ADC_Enable_Now();
+	}
+
+	// Check again later instead of spinning
+	if (adc_state == ADC_STATE_STOPPING || adc_state == ADC_STATE_DISABLING)
+	{
+		TIM6->CNT = 0;
+		TIM6->CR1 |= TIM_CR1_CEN;
+	}
 }
 
-inline void ADC_Set_SMPR(const uint8_t smpr)
+void ADC_Async_Arm(ADC_Callback window_done)
 {
-	// Stop any ongoing ADC conversion
-	ADC1->CR |= ADC_CR_ADSTP;
-	while((ADC1->CR & ADC_CR_ADSTP) == ADC_CR_ADSTP);
+	// Enables the ADC if needed, then starts conversion on the next TIM15_TRGO
+	// window_done is called from the DMA interrupt once the window is in adc_acq_data
+	struct ADC_Done d = {0};
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	// A superseded disable request never calls its callback
+	adc_window_done = window_done;
+	adc_pending &= ~ADC_PENDING_DISABLE;
+	disable_done = 0;
+	if (adc_state != ADC_STATE_ARMED)
+	{
+		adc_pending |= ADC_PENDING_ARM;
+		ADC_Step(&d);
+	}
 
-	ADC1->SMPR = smpr;
+	__set_PRIMASK(primask);
+	ADC_Done_Run(&d);
 }
 
-uint16_t ADC_Find_Max_Value(void)
+void ADC_Async_Disable(ADC_Callback done)
 {
-	uint16_t adc_max = 0;
-	for (uint32_t i = 0; i < ADC_ACQ_DATA_SIZE; ++i)
+	// Aborts a running window, done is called once ADEN is cleared
+	struct ADC_Done d = {0};
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	adc_pending &= ~ADC_PENDING_ARM;
+	if (adc_state == ADC_STATE_OFF)
 	{
-		if (adc_acq_data[i] >= adc_max)
+		ADC_Done_Add(&d, done);
+	}
+	else
+	{
+		disable_done = done;
+		adc_pending |= ADC_PENDING_DISABLE;
+		if (adc_state == ADC_STATE_ARMED)
 		{
-			adc_max = adc_acq_data[i];
+			// Stop ADC conversion
+			ADC1->CR |= ADC_CR_ADSTP;
+			adc_state = ADC_STATE_STOPPING;
 		}
+		ADC_Step(&d);
 	}
-	return adc_max;
+
+	__set_PRIMASK(primask);
+	ADC_Done_Run(&d);
 }
 
-uint8_t ADC_Update_Max_Data(void)
+void ADC_Async_Set_SMPR(const uint8_t smpr, ADC_Callback done)
 {
-	static uint16_t n = 0;
-	if (n < ADC_MAX_DATA_SIZE)
+	// Written at once when idle, otherwise at the end of the current window (not aborted)
+	struct ADC_Done d = {0};
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	pending_smpr = smpr;
+	smpr_done = done;
+	adc_pending |= ADC_PENDING_SMPR;
+	ADC_Step(&d);
+
+	__set_PRIMASK(primask);
+	ADC_Done_Run(&d);
+}
+
+void ADC_Async_Service(void)
+{
+	// Called from TIM6 update interrupt while ADSTP or ADDIS is in progress
+	struct ADC_Done d = {0};
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	ADC_Step(&d);
+
+	__set_PRIMASK(primask);
+	ADC_Done_Run(&d);
+}
+
+inline uint8_t ADC_Get_State(void)
+{
+	return adc_state;
+}
+
+void ADC_IRQ_Process(void)
+{
+	// Called from ADC1_COMP_IRQHandler, source is ADRDY
+	struct ADC_Done d = {0};
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	if ((ADC1->ISR & ADC_ISR_ADRDY) == ADC_ISR_ADRDY)
 	{
-		adc_max_data[n] = ADC_Find_Max_Value();
-		++n;
+		// Clear interrupt
+		ADC1->ISR = ADC_ISR_ADRDY;
+
+		if (adc_state == ADC_STATE_ENABLING)
+		{
+			adc_state = ADC_STATE_READY;
+			TRACE(TRACE_ADC_READY, 0);
+		}
 	}
-	else
+	ADC_Step(&d);
+
+	__set_PRIMASK(primask);
+	ADC_Done_Run(&d);
+}
+
+void ADC_DMA_IRQ_Process(void)
+{
+	// Called from DMA1_Channel1_IRQHandler, source is transfer complete (window full)
+	struct ADC_Done d = {0};
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	// Clear interrupt
+	DMA1->IFCR = DMA_IFCR_CGIF1;
+
+	if (adc_state == ADC_STATE_ARMED)
 	{
-		n = 0;
+		// Stop continuous conversion right away, completion is checked by ADC_Step()
+		ADC1->CR |= ADC_CR_ADSTP;
+		adc_state = ADC_STATE_STOPPING;
+		TRACE(TRACE_ADC_WINDOW, 0);
+
+		ADC_Done_Add(&d, adc_window_done);
 	}
-	// if n > 0: still filling buffer
-	// if n = 0: done filling buffer
-	return n;
+	ADC_Step(&d);
+
+	__set_PRIMASK(primask);
+	ADC_Done_Run(&d);
+}
+
+uint16_t ADC_Find_Max_Value(uint16_t* min)
+{
+	// Largest sample of the window, smallest one in min (same pass)
+	uint16_t adc_max = 0;
+	uint16_t adc_min = 0xFFFF;
+	for (uint32_t i = 0; i < ADC_ACQ_DATA_SIZE; ++i)
+	{
+		if (adc_acq_data[i] >= adc_max)
+		{
+			adc_max = adc_acq_data[i];
+		}
+		if (adc_acq_data[i] < adc_min)
+		{
+			adc_min = adc_acq_data[i];
+		}
+	}
+	*min = adc_min;
+	return adc_max;
 }
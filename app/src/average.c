@@ -0,0 +1,85 @@
+/*
+ * average.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "average.h"
+#include "fixmath.h"
+#include "adc.h"
+#include "acq.h"
+#include "stm32f0xx.h"
+
+// declared in adc.c
+extern uint16_t adc_acq_data[ADC_ACQ_DATA_SIZE];
+
+// Every window starts on the TIM15 overflow: sample k of each window has the same signal phase,
+// the sum grows as N while uncorrelated noise only grows as sqrt(N)
+// 1023 * 1024 periods fits easily in 32 bits: sums in acq_work.average.acc, the averaged
+// window is written over them and dumped by main.c
+static uint32_t avg_windows = 0;
+
+// Sums already replaced by the averaged window, extremes kept for the next calls
+static uint8_t avg_done = 0;
+static uint32_t avg_max = 0;
+static uint32_t avg_min = 0;
+
+static uint8_t avg_enable = 0;
+
+void AVG_Reset(void)
+{
+	for (uint32_t i = 0; i < ADC_ACQ_DATA_SIZE; ++i)
+	{
+		acq_work.average.acc[i] = 0;
+	}
+	avg_windows = 0;
+	avg_done = 0;
+}
+
+void AVG_Window(void)
+{
+	// Called from the bottom half with the window of the period in adc_acq_data
+	for (uint32_t i = 0; i < ADC_ACQ_DATA_SIZE; ++i)
+	{
+		acq_work.average.acc[i] += adc_acq_data[i];
+	}
+	++avg_windows;
+}
+
+uint8_t AVG_Get_Result(struct AVG_Result* result)
+{
+	// Main loop, once the run is over: sums to averages, then their extremes
+	result->windows = avg_windows;
+	if (avg_windows == 0) return 0;
+
+	if (!avg_done)
+	{
+		uint32_t max = 0;
+		uint32_t min = 0xFFFFFFFF;
+		for (uint32_t i = 0; i < ADC_ACQ_DATA_SIZE; ++i)
+		{
+			// data[i] is written over acc[i / 2], already read
+			const uint32_t sum = acq_work.average.acc[i];
+			if (sum > max) max = sum;
+			if (sum < min) min = sum;
+			acq_work.average.data[i] = (uint16_t) FIX_Div(sum * AVG_SCALE + avg_windows / 2, avg_windows);
+		}
+		avg_max = FIX_Div(max * 100 + avg_windows / 2, avg_windows);
+		avg_min = FIX_Div(min * 100 + avg_windows / 2, avg_windows);
+		avg_done = 1;
+	}
+
+	result->max = avg_max;
+	result->min = avg_min;
+	return 1;
+}
+
+inline void AVG_Set_Enable(const uint8_t enable)
+{
+	avg_enable = enable;
+}
+
+inline uint8_t AVG_Get_Enable(void)
+{
+	return avg_enable;
+}
@@ -0,0 +1,108 @@
+/*
+ * bode.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "bode.h"
+#include "fixmath.h"
+#include "lockin.h"
+#include "peak.h"
+#include "average.h"
+#include "thd.h"
+#include "summary.h"
+#include "acq.h"
+#include "stm32f0xx.h"
+
+static uint16_t bode_ref = BODE_REF_DEFAULT;
+
+uint8_t BODE_Reduce(struct BODE_Row* row, const uint16_t psc, const uint16_t divide_by, const uint16_t n_periods)
+{
+	// Mean over the periods of the run: a dropped record left zeros in both arrays
+	uint32_t cnt_sum = 0;
+	uint32_t amplitude_sum = 0;
+	uint32_t n = 0;
+
+	if (SUM_Get_Enable())
+	{
+		// Summary mode: the means are already there, as sums over SUM_MEAN_SCALE periods
+		const struct SUM_Point* p = SUM_Get_Last();
+		row->n = p->n;
+		if (p->n == 0 || p->period_mean == 0 || psc == 0) return 0;
+		cnt_sum = p->period_mean;
+		amplitude_sum = p->amplitude_mean;
+		n = SUM_MEAN_SCALE;
+	}
+	else
+	{
+		for (uint32_t i = 0; i < n_periods && i < ACQ_N_PERIODS; ++i)
+		{
+			if (acq_results.timer_cnt[i] == 0) continue;
+			cnt_sum += acq_results.timer_cnt[i];
+			amplitude_sum += acq_results.adc_max_data[i];
+			++n;
+		}
+
+		row->n = (uint16_t) n;
+		if (n == 0 || psc == 0) return 0;
+	}
+
+	// One capture spans divide-by +1 input periods of psc / BODE_TIMER_FREQ s per count:
+	// f = BODE_TIMER_FREQ * (divide-by +1) * n / (psc * sum of counts), x100 for two decimals
+	const uint64_t num = (uint64_t) BODE_TIMER_FREQ * 100 * (divide_by + 1) * n;
+	const uint64_t den = (uint64_t) psc * cnt_sum;
+	const uint64_t f = (num + den / 2) / den;
+	row->frequency = (f > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t) f;
+
+	// Lock-in amplitude resolves levels well below one code, the peak does not
+	// The peak of the averaged window is not biased up by the noise like the mean of the peaks
+	// The interpolated crest and trough do not lose up to 1 - cos(pi / samples per period) at high frequency
+	struct LOCKIN_Result lockin;
+	struct AVG_Result average;
+	struct PEAK_Result peak;
+	row->lockin = LOCKIN_Get_Enable() && LOCKIN_Get_Result(&lockin);
+	if (row->lockin)
+	{
+		row->amplitude = lockin.amplitude;
+		row->phase = FIX_ANGLE_TO_CENTIDEG(lockin.phase);
+	}
+	else if (AVG_Get_Enable() && AVG_Get_Result(&average))
+	{
+		// Same AC peak as the done screen
+		row->amplitude = (average.max > average.min) ? (average.max - average.min) / 2 : 0;
+		row->phase = 0;
+	}
+	else if (PEAK_Get_Enable() && PEAK_Get_Result(&peak))
+	{
+		row->amplitude = peak.amplitude;
+		row->phase = 0;
+	}
+	else
+	{
+		// Mean peak above the mean minimum of the windows: the DC level of the input is left out
+		const uint32_t max = (amplitude_sum * 100 + n / 2) / n;
+		const uint32_t min = ACQ_Get_Trough();
+		row->amplitude = (max > min) ? (max - min) / 2 : 0;
+		row->phase = 0;
+	}
+
+	// Distortion of the same windows, no extra acquisition
+	struct THD_Result thd;
+	row->harmonics = (THD_Get_Enable() && THD_Get_Result(&thd)) ? (uint8_t) thd.harmonics : 0;
+	row->thd = (row->harmonics > 0) ? thd.thd : 0;
+
+	// 20 * log10(amplitude / reference), from the log10 table
+	row->gain = (row->amplitude > 0) ? FIX_dB(row->amplitude, bode_ref) : INT32_MIN;
+	return 1;
+}
+
+inline void BODE_Set_Reference(const uint16_t amplitude)
+{
+	// Hundredths of ADC code
+	bode_ref = (amplitude > 0) ? amplitude : 1;
+}
+
+inline uint16_t BODE_Get_Reference(void)
+{
+	return bode_ref;
+}
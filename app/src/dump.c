@@ -0,0 +1,333 @@
+/*
+ * dump.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "dump.h"
+#include "transport.h"
+
+// Header and trailer frames read by the USART2 TX DMA, one per block
+static uint8_t dma_header[DUMP_BLOCK_MAX + 1][DUMP_HEADER_SIZE];
+static uint8_t dma_trailer[DUMP_BLOCK_MAX + 1][DUMP_TRAILER_SIZE];
+
+// Successive values differ very little for a stable input: each value is
+// sent as the zigzag-encoded difference with the previous one, in a LEB128
+// varint (7 bits per byte, MSB set when more bytes follow).
+// A difference within [-64, 63] fits in one byte instead of 2 (binary) or ~6 (text)
+
+static inline uint32_t Zigzag(const int32_t delta)
+{
+	return ((uint32_t) delta << 1) ^ (uint32_t) (delta >> 31);
+}
+
+static inline uint32_t Varint_Size(uint32_t v)
+{
+	uint32_t size = 1;
+	while (v >= 0x80)
+	{
+		v >>= 7;
+		++size;
+	}
+	return size;
+}
+
+uint32_t DUMP_Text_Size(const uint16_t* data, const uint32_t n)
+{
+	// Same format as the text dump: "%d, " for every value
+	uint32_t size = 0;
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		const uint16_t v = data[i];
+		size += 2 + 1 + (v >= 10) + (v >= 100) + (v >= 1000) + (v >= 10000);
+	}
+	return size;
+}
+
+uint32_t DUMP_Delta_Varint_Size(const uint16_t* data, const uint32_t n)
+{
+	uint32_t size = 0;
+	uint16_t previous = 0;
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		size += Varint_Size(Zigzag((int32_t) data[i] - (int32_t) previous));
+		previous = data[i];
+	}
+	return size;
+}
+
+uint32_t DUMP_Delta_Varint_Send(const uint8_t block_id, const uint16_t* data, const uint32_t n)
+{
+	const uint32_t payload_size = DUMP_Delta_Varint_Size(data, n);
+	uint8_t checksum = 0;
+	uint16_t previous = 0;
+
+	DUMP_Frame_Begin(block_id, DUMP_ENC_DELTA_VARINT, n, payload_size);
+
+	// Payload
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		uint32_t v = Zigzag((int32_t) data[i] - (int32_t) previous);
+		previous = data[i];
+
+		while (v >= 0x80)
+		{
+			const uint8_t byte = (uint8_t) (v | 0x80);
+			checksum += byte;
+			TRANSPORT_Send_Byte(byte);
+			v >>= 7;
+		}
+		checksum += (uint8_t) v;
+		TRANSPORT_Send_Byte((uint8_t) v);
+	}
+
+	DUMP_Frame_End(checksum);
+
+	// Total number of bytes on the wire
+	return DUMP_HEADER_SIZE + payload_size + 1;
+}
+
+static uint8_t Raw_DMA_Queue(const uint8_t block_id, const uint8_t encoding, const void* data, const uint32_t n, const uint32_t payload_size)
+{
+	// The DMA (or the USB packet copy) reads data in place (little endian values): the CPU does no per-byte work,
+	// data must not be modified before the transfer is over (see TRANSPORT_Busy())
+	if (block_id > DUMP_BLOCK_MAX) return 0;
+
+	// All of the frame or nothing: a header alone would leave a truncated frame on the wire
+	if (TRANSPORT_Space() < DUMP_DMA_ENTRIES_PER_BLOCK) return 0;
+
+	uint8_t* header = dma_header[block_id];
+	uint8_t* trailer = dma_trailer[block_id];
+
+	header[0] = DUMP_MAGIC_0;
+	header[1] = DUMP_MAGIC_1;
+	header[2] = block_id;
+	header[3] = encoding;
+	header[4] = (uint8_t) n;
+	header[5] = (uint8_t) (n >> 8);
+	header[6] = (uint8_t) payload_size;
+	header[7] = (uint8_t) (payload_size >> 8);
+
+	trailer[0] = DUMP_MAGIC_1;
+	trailer[1] = DUMP_MAGIC_0;
+	trailer[2] = block_id;
+
+	return TRANSPORT_Queue(header, DUMP_HEADER_SIZE)
+		&& TRANSPORT_Queue(data, (uint16_t) payload_size)
+		&& TRANSPORT_Queue(trailer, DUMP_TRAILER_SIZE);
+}
+
+uint8_t DUMP_Raw_DMA_Queue(const uint8_t block_id, const uint16_t* data, const uint32_t n)
+{
+	return Raw_DMA_Queue(block_id, DUMP_ENC_RAW16, data, n, 2 * n);
+}
+
+uint8_t DUMP_Raw32_DMA_Queue(const uint8_t block_id, const uint32_t* data, const uint32_t n)
+{
+	return Raw_DMA_Queue(block_id, DUMP_ENC_RAW32, data, n, 4 * n);
+}
+
+uint32_t DUMP_Text32_Size(const uint32_t* data, const uint32_t n)
+{
+	// Same format as the text dump: "%d, " for every value
+	uint32_t size = 0;
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		uint32_t v = data[i];
+		size += 3;
+		while (v >= 10)
+		{
+			v /= 10;
+			++size;
+		}
+	}
+	return size;
+}
+
+uint32_t DUMP_Delta_Varint32_Send(const uint8_t block_id, const uint32_t* data, const uint32_t n)
+{
+	// Timestamps grow by about one period: the differences are small
+	uint32_t payload_size = 0;
+	uint32_t previous = 0;
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		payload_size += Varint_Size(Zigzag((int32_t) (data[i] - previous)));
+		previous = data[i];
+	}
+
+	uint8_t checksum = 0;
+	previous = 0;
+
+	DUMP_Frame_Begin(block_id, DUMP_ENC_DELTA_VARINT32, n, payload_size);
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		uint32_t v = Zigzag((int32_t) (data[i] - previous));
+		previous = data[i];
+
+		while (v >= 0x80)
+		{
+			const uint8_t byte = (uint8_t) (v | 0x80);
+			checksum += byte;
+			TRANSPORT_Send_Byte(byte);
+			v >>= 7;
+		}
+		checksum += (uint8_t) v;
+		TRANSPORT_Send_Byte((uint8_t) v);
+	}
+	DUMP_Frame_End(checksum);
+
+	return DUMP_HEADER_SIZE + payload_size + 1;
+}
+
+void DUMP_Frame_Begin(const uint8_t block_id, const uint8_t encoding, const uint32_t n, const uint32_t payload_size)
+{
+	// Header of a frame sent byte by byte, payload_size bytes must follow
+	TRANSPORT_Send_Byte(DUMP_MAGIC_0);
+	TRANSPORT_Send_Byte(DUMP_MAGIC_1);
+	TRANSPORT_Send_Byte(block_id);
+	TRANSPORT_Send_Byte(encoding);
+	TRANSPORT_Send_Byte((uint8_t) n);
+	TRANSPORT_Send_Byte((uint8_t) (n >> 8));
+	TRANSPORT_Send_Byte((uint8_t) payload_size);
+	TRANSPORT_Send_Byte((uint8_t) (payload_size >> 8));
+}
+
+uint8_t DUMP_Frame_Bytes(const void* data, const uint32_t size, uint8_t checksum)
+{
+	// Sends part of the payload, returns the updated checksum
+	const uint8_t* bytes = (const uint8_t*) data;
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		checksum += bytes[i];
+		TRANSPORT_Send_Byte(bytes[i]);
+	}
+	return checksum;
+}
+
+inline void DUMP_Frame_End(const uint8_t checksum)
+{
+	TRANSPORT_Send_Byte(checksum);
+}
+
+#ifdef TEST_DUMP
+/*
+ * Host round trip of the frames through the loopback transport, build with
+ *   gcc -O2 -DTEST_DUMP -DTRANSPORT_LOOPBACK -Iapp/inc app/src/dump.c app/src/transport.c
+ * The frames can also be checked with the decoder: ./a.out capture.bin && python3 tools/dump_decode.py capture.bin
+ */
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_N 300
+
+static uint32_t test_pos = 0;
+
+static uint32_t Test_Read(const uint32_t size)
+{
+	// Little endian field of the loopback stream
+	uint32_t v = 0;
+	for (uint32_t i = 0; i < size; ++i)
+	{
+		v |= (uint32_t) loopback_buf[test_pos++] << (8 * i);
+	}
+	return v;
+}
+
+static uint32_t Test_Frame(const uint8_t block_id, const uint8_t encoding, const void* expected, const uint32_t n)
+{
+	// Decodes the next frame and compares it with the values sent, returns the number of errors
+	uint32_t errors = 0;
+	if (Test_Read(1) != DUMP_MAGIC_0 || Test_Read(1) != DUMP_MAGIC_1) ++errors;
+	if (Test_Read(1) != block_id || Test_Read(1) != encoding || Test_Read(2) != n) ++errors;
+
+	const uint32_t payload_size = Test_Read(2);
+	const uint32_t payload_start = test_pos;
+	uint8_t checksum = 0;
+	for (uint32_t i = 0; i < payload_size; ++i)
+	{
+		checksum += loopback_buf[payload_start + i];
+	}
+
+	const uint32_t wide = (encoding == DUMP_ENC_RAW32 || encoding == DUMP_ENC_DELTA_VARINT32);
+	uint32_t previous = 0;
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		uint32_t v;
+		if (encoding == DUMP_ENC_RAW16 || encoding == DUMP_ENC_RAW32)
+		{
+			v = Test_Read(wide ? 4 : 2);
+		}
+		else
+		{
+			// Zigzag varint of the difference with the previous value
+			uint32_t z = 0;
+			uint32_t shift = 0;
+			uint8_t byte;
+			do
+			{
+				byte = loopback_buf[test_pos++];
+				z |= (uint32_t) (byte & 0x7F) << shift;
+				shift += 7;
+			} while (byte & 0x80);
+			v = previous + ((z >> 1) ^ -(z & 1));
+			if (!wide) v &= 0xFFFF;
+			previous = v;
+		}
+
+		const uint32_t ref = wide ? ((const uint32_t*) expected)[i] : ((const uint16_t*) expected)[i];
+		if (v != ref) ++errors;
+	}
+	if (test_pos != payload_start + payload_size) ++errors;
+
+	if (encoding == DUMP_ENC_RAW16 || encoding == DUMP_ENC_RAW32)
+	{
+		// Raw DMA frames end with the trailer
+		if (Test_Read(1) != DUMP_MAGIC_1 || Test_Read(1) != DUMP_MAGIC_0 || Test_Read(1) != block_id) ++errors;
+	}
+	else if (Test_Read(1) != checksum)
+	{
+		++errors;
+	}
+	return errors;
+}
+
+int main(int argc, char** argv)
+{
+	// Slow ramp with noise, full scale jumps and 32-bit timestamps with a wrap
+	uint16_t data16[TEST_N];
+	uint32_t data32[TEST_N];
+	uint32_t seed = 1;
+	for (uint32_t i = 0; i < TEST_N; ++i)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		data16[i] = (uint16_t) ((i % 50 == 49) ? ((i & 1) ? 0xFFFF : 0) : 500 + i + (seed >> 29));
+		data32[i] = 0xFFFFF000u + i * 1000u + (seed >> 28);
+	}
+
+	uint32_t sent = 0;
+	sent += DUMP_Delta_Varint_Send(DUMP_BLOCK_ADC_MAX, data16, TEST_N);
+	sent += DUMP_Delta_Varint32_Send(DUMP_BLOCK_PERIOD_TIME, data32, TEST_N);
+	const uint8_t queued = DUMP_Raw_DMA_Queue(DUMP_BLOCK_TIMER_CNT, data16, TEST_N) && DUMP_Raw32_DMA_Queue(DUMP_BLOCK_PERIOD_TIME, data32, TEST_N);
+	sent += 2 * (DUMP_HEADER_SIZE + DUMP_TRAILER_SIZE) + 6 * TEST_N;
+
+	uint32_t errors = (queued && sent == loopback_len) ? 0 : 1;
+	errors += Test_Frame(DUMP_BLOCK_ADC_MAX, DUMP_ENC_DELTA_VARINT, data16, TEST_N);
+	errors += Test_Frame(DUMP_BLOCK_PERIOD_TIME, DUMP_ENC_DELTA_VARINT32, data32, TEST_N);
+	errors += Test_Frame(DUMP_BLOCK_TIMER_CNT, DUMP_ENC_RAW16, data16, TEST_N);
+	errors += Test_Frame(DUMP_BLOCK_PERIOD_TIME, DUMP_ENC_RAW32, data32, TEST_N);
+	if (test_pos != loopback_len) ++errors;
+
+	if (argc > 1)
+	{
+		FILE* f = fopen(argv[1], "wb");
+		if (f)
+		{
+			fwrite(loopback_buf, 1, loopback_len, f);
+			fclose(f);
+		}
+	}
+
+	printf("%u bytes in 4 frames, %u errors\n", loopback_len, errors);
+	return errors != 0;
+}
+#endif
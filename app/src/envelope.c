@@ -0,0 +1,81 @@
+/*
+ * envelope.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "envelope.h"
+#include "acq.h"
+#include "stm32f0xx.h"
+
+// Settings restored at the end of the sweep
+static struct ACQ_Settings saved_settings;
+
+// Point being tested
+static struct ACQ_Settings env_settings;
+
+static struct ENV_Result env_result[ENV_N_SMPR];
+
+void ENV_Start(void)
+{
+	// Steps SMPR from 0 to 7 and, for each, divide-by from the previous safe value
+	// up to the first one that runs ENV_N_PERIODS periods without overrun
+	ACQ_Get_Settings(&saved_settings);
+
+	for (uint32_t i = 0; i < ENV_N_SMPR; ++i)
+	{
+		env_result[i].tested = 0;
+	}
+
+	env_settings = saved_settings;
+	env_settings.smpr = 0;
+	env_settings.divide_by = 1;
+	env_settings.n_periods = ENV_N_PERIODS;
+	env_settings.auto_divide = 0;
+	env_settings.tolerance = 0;
+
+	ACQ_Restart(&env_settings);
+}
+
+uint8_t ENV_Run_Done(void)
+{
+	// Called by the main loop at the end of each run, returns 1 when the sweep is over
+	const struct ACQ_Overrun_Stats* overrun = ACQ_Get_Overrun_Stats();
+	const struct ACQ_Timing* timing = ACQ_Get_Timing();
+	struct ENV_Result* r = &env_result[env_settings.smpr];
+
+	r->tested = 1;
+	r->divide_by = env_settings.divide_by;
+	r->safe = (overrun->count == 0);
+	r->slack_min = timing->slack_min;
+	r->busy = (r->safe && timing->trigger_period > timing->slack_min) ? timing->trigger_period - timing->slack_min : 0;
+
+	if (!r->safe && env_settings.divide_by < ENV_DIVIDE_BY_MAX)
+	{
+		env_settings.divide_by *= 2;
+	}
+	else if (env_settings.smpr + 1 < ENV_N_SMPR)
+	{
+		// Longer sampling time never needs a lower divide-by
+		++env_settings.smpr;
+	}
+	else
+	{
+		ACQ_Apply_Settings(&saved_settings);
+		return 1;
+	}
+
+	ACQ_Restart(&env_settings);
+	return 0;
+}
+
+void ENV_Abort(void)
+{
+	ACQ_Abort();
+	ACQ_Apply_Settings(&saved_settings);
+}
+
+inline const struct ENV_Result* ENV_Get_Result(const uint8_t smpr)
+{
+	return &env_result[smpr];
+}
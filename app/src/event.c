@@ -0,0 +1,80 @@
+/*
+ * event.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "event.h"
+#include "trace.h"
+#include "tick.h"
+#include "stm32f0xx.h"
+
+// Events posted by ISRs (several priorities) and read by the main loop
+static struct Event event_queue[EVENT_QUEUE_SIZE];
+static volatile uint8_t event_head = 0;
+static volatile uint8_t event_tail = 0;
+
+// Number of events lost because the queue was full
+volatile uint32_t event_overflow = 0;
+
+void EVENT_Init(void)
+{
+	event_head = 0;
+	event_tail = 0;
+
+	NVIC_SetPriority(PendSV_IRQn, PENDSV_INT_PRIORITY);
+}
+
+void EVENT_Post(const uint8_t id, const uint8_t arg)
+{
+	// No exclusive access instructions on Cortex-M0: short critical section,
+	// PRIMASK is restored so this can be called with interrupts already disabled
+	const uint64_t time = TICK_Get_Time();
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	const uint8_t next = (event_head + 1) % EVENT_QUEUE_SIZE;
+	if (next != event_tail)
+	{
+		event_queue[event_head].time = time;
+		event_queue[event_head].id = id;
+		event_queue[event_head].arg = arg;
+		event_head = next;
+		TRACE(TRACE_EVENT_POST, (uint16_t) (id << 8 | arg));
+	}
+	else
+	{
+		++event_overflow;
+	}
+
+	__set_PRIMASK(primask);
+}
+
+uint8_t EVENT_Get(struct Event* evt)
+{
+	// Only the main loop reads: no lock needed
+	if (event_tail == event_head) return 0;
+
+	*evt = event_queue[event_tail];
+	event_tail = (event_tail + 1) % EVENT_QUEUE_SIZE;
+	TRACE(TRACE_EVENT_GET, (uint16_t) (evt->id << 8 | evt->arg));
+	return 1;
+}
+
+void EVENT_Wait(void)
+{
+	// Interrupts are masked between the check and WFI so an event posted in between
+	// is not missed: a pending interrupt still wakes the core, then runs when unmasked
+	__disable_irq();
+	if (event_tail == event_head)
+	{
+		__WFI();
+	}
+	__enable_irq();
+}
+
+inline void EVENT_Pend_Bottom_Half(void)
+{
+	// Runs PendSV_Handler as soon as no other interrupt is active
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
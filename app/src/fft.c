@@ -0,0 +1,307 @@
+/*
+ * fft.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "fft.h"
+#include "fixmath.h"
+#include "adc.h"
+#include "acq.h"
+
+// declared in adc.c
+extern uint16_t adc_acq_data[ADC_ACQ_DATA_SIZE];
+
+// Complex points of the packed real FFT: z[n] = x[2n] + j x[2n + 1]
+#define FFT_M (FFT_N / 2)
+
+// Largest component a radix-2 stage can take without (or with one) halving:
+// |a + W b| components stay below (1 + sqrt(2)) times the largest input component
+#define FFT_PEAK_0 13573
+#define FFT_PEAK_1 27146
+
+// Full scale bin: sine of 512 codes peak in 1/16 code, times N / 4 (Hann coherent gain 1/2)
+#define FFT_FULL_SCALE_SHIFT 19
+
+// Main lobe of the Hann window, left out of the spur and floor (bins each side)
+#define FFT_LOBE 3
+
+// Sum of the bin magnitudes over the windows in acq_work.fft.acc, unscaled (1/16 code):
+// at most 2^20 per window
+static uint32_t fft_windows = 0;
+
+static uint8_t fft_mode = FFT_OFF;
+
+void FFT_Reset(void)
+{
+	for (uint32_t k = 0; k < FFT_N_BINS; ++k)
+	{
+		acq_work.fft.acc[k] = 0;
+	}
+	fft_windows = 0;
+}
+
+static uint32_t FFT_Load(int16_t* z)
+{
+	// Hann window sin^2(pi k / N) = (1 - cos(2 pi k / N)) / 2 from the sine table, mean removed
+	// with 1/16 code resolution: |x| < 2^14. Pairs go to bit-reversed positions (Gold-Rader counter)
+	// Returns the largest component
+	uint32_t sum = 0;
+	for (uint32_t k = 0; k < FFT_N; ++k)
+	{
+		sum += adc_acq_data[k];
+	}
+	const int32_t mean = (int32_t) ((sum + 8) >> 4);
+
+	uint32_t peak = 0;
+	uint32_t j = 0;
+	for (uint32_t n = 0; n < FFT_M; ++n)
+	{
+		for (uint32_t i = 0; i < 2; ++i)
+		{
+			const uint32_t k = 2 * n + i;
+			const int32_t w = (32768 - fix_sin_table[(k + FFT_N / 4) & (FFT_N - 1)]) >> 1;
+			const int32_t x = ((((int32_t) adc_acq_data[k] << 4) - mean) * w) >> 15;
+			const uint32_t a = (x < 0) ? -x : x;
+			if (a > peak) peak = a;
+			z[2 * j + i] = (int16_t) x;
+		}
+
+		uint32_t bit = FFT_M >> 1;
+		while (j & bit)
+		{
+			j ^= bit;
+			bit >>= 1;
+		}
+		j |= bit;
+	}
+	return peak;
+}
+
+static uint32_t FFT_Complex(int16_t* z, uint32_t peak)
+{
+	// In-place radix-2 decimation in time over FFT_M points, Q15 twiddles from the sine table
+	// (W_2h^k = W_N^(k N / 2h)), 16 x 16 products only (single cycle MULS)
+	// Block floating point: a stage halves its outputs only when they could overflow,
+	// returns the number of halvings
+	uint32_t exponent = 0;
+	for (uint32_t half = 1; half < FFT_M; half <<= 1)
+	{
+		const uint32_t shift = (peak < FFT_PEAK_0) ? 0 : (peak < FFT_PEAK_1) ? 1 : 2;
+		const int32_t round = (1 << shift) >> 1;
+		const uint32_t step = FFT_N / (2 * half);
+		exponent += shift;
+		peak = 0;
+
+		for (uint32_t k = 0; k < half; ++k)
+		{
+			// W = cos - j sin
+			const int32_t wr = fix_sin_table[(k * step + FFT_N / 4) & (FFT_N - 1)];
+			const int32_t wi = -fix_sin_table[k * step];
+			for (uint32_t i = k; i < FFT_M; i += 2 * half)
+			{
+				int16_t* a = &z[2 * i];
+				int16_t* b = &z[2 * (i + half)];
+				const int32_t tr = (b[0] * wr - b[1] * wi + (1 << 14)) >> 15;
+				const int32_t ti = (b[0] * wi + b[1] * wr + (1 << 14)) >> 15;
+				const int32_t v[4] = {(a[0] + tr + round) >> shift, (a[1] + ti + round) >> shift, (a[0] - tr + round) >> shift, (a[1] - ti + round) >> shift};
+				a[0] = (int16_t) v[0];
+				a[1] = (int16_t) v[1];
+				b[0] = (int16_t) v[2];
+				b[1] = (int16_t) v[3];
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					const uint32_t m = (v[c] < 0) ? -v[c] : v[c];
+					if (m > peak) peak = m;
+				}
+			}
+		}
+	}
+	return exponent;
+}
+
+static void FFT_Magnitude(const int16_t* z, const uint32_t exponent)
+{
+	// Real spectrum from the packed FFT, Z[M] = Z[0]:
+	// 2 X[k] = (Z[k] + Z*[M - k]) - j W^k (Z[k] - Z*[M - k]), W = exp(-2 pi j / N)
+	for (uint32_t k = 0; k <= FFT_M; ++k)
+	{
+		const uint32_t m = (FFT_M - k) & (FFT_M - 1);
+		const int32_t a = z[2 * (k & (FFT_M - 1))];
+		const int32_t b = z[2 * (k & (FFT_M - 1)) + 1];
+		const int32_t c = z[2 * m];
+		const int32_t d = z[2 * m + 1];
+
+		// Even part (a + c, b - d) and odd part (b + d, c - a), times 2
+		const int32_t e_re = a + c;
+		const int32_t e_im = b - d;
+		const int32_t o_re = b + d;
+		const int32_t o_im = c - a;
+		const int32_t wr = fix_sin_table[(k + FFT_N / 4) & (FFT_N - 1)];
+		const int32_t ws = fix_sin_table[k];
+		int32_t xr = e_re + ((o_re * wr + o_im * ws) >> 15);
+		int32_t xi = e_im + ((o_im * wr - o_re * ws) >> 15);
+
+		// Both below 2^15 for the square root, the exponent keeps the scale
+		int32_t s = (int32_t) exponent - 1;
+		while (xr >= 32768 || xr <= -32768 || xi >= 32768 || xi <= -32768)
+		{
+			xr >>= 1;
+			xi >>= 1;
+			++s;
+		}
+		const uint32_t magnitude = FIX_Sqrt((uint32_t) (xr * xr) + (uint32_t) (xi * xi));
+		acq_work.fft.acc[k] += (s >= 0) ? magnitude << s : magnitude >> 1;
+	}
+}
+
+void FFT_Window(void)
+{
+	// Called from the bottom half with the window of the period in adc_acq_data
+	if (fft_mode == FFT_LAST) FFT_Reset();
+
+	const uint32_t peak = FFT_Load(acq_work.fft.buffer.z);
+	const uint32_t exponent = FFT_Complex(acq_work.fft.buffer.z, peak);
+	FFT_Magnitude(acq_work.fft.buffer.z, exponent);
+	++fft_windows;
+}
+
+uint8_t FFT_Get_Result(struct FFT_Result* result)
+{
+	// Main loop, once the run is over: levels in acq_work.fft.buffer, then the peak, spur and floor
+	result->windows = fft_windows;
+	if (fft_windows == 0) return 0;
+
+	const uint32_t full_scale = fft_windows << FFT_FULL_SCALE_SHIFT;
+	uint32_t peak_bin = FFT_LOBE;
+	for (uint32_t k = 0; k < FFT_N_BINS; ++k)
+	{
+		acq_work.fft.buffer.level[k] = (acq_work.fft.acc[k] > 0) ? (int16_t) FIX_dB(acq_work.fft.acc[k], full_scale) : FFT_LEVEL_ZERO;
+		if (k >= FFT_LOBE && acq_work.fft.acc[k] > acq_work.fft.acc[peak_bin]) peak_bin = k;
+	}
+
+	// DC (mean removed, Hann lobe) and the main lobe of the peak are left out
+	uint32_t spur_bin = 0;
+	int32_t floor_sum = 0;
+	uint32_t floor_n = 0;
+	for (uint32_t k = FFT_LOBE; k < FFT_N_BINS; ++k)
+	{
+		if (k + FFT_LOBE >= peak_bin && k <= peak_bin + FFT_LOBE) continue;
+		if (spur_bin == 0 || acq_work.fft.acc[k] > acq_work.fft.acc[spur_bin]) spur_bin = k;
+		if (acq_work.fft.acc[k] > 0)
+		{
+			floor_sum += acq_work.fft.buffer.level[k];
+			++floor_n;
+		}
+	}
+
+	result->peak_bin = peak_bin;
+	result->peak = acq_work.fft.buffer.level[peak_bin];
+	result->spur_bin = spur_bin;
+	result->spur = (acq_work.fft.acc[spur_bin] > 0 && acq_work.fft.acc[peak_bin] > 0) ? FIX_dB(acq_work.fft.acc[spur_bin], acq_work.fft.acc[peak_bin]) : FFT_LEVEL_ZERO;
+	result->floor = (floor_n > 0) ? floor_sum / (int32_t) floor_n : FFT_LEVEL_ZERO;
+	return 1;
+}
+
+inline void FFT_Set_Mode(const uint8_t mode)
+{
+	fft_mode = mode;
+}
+
+inline uint8_t FFT_Get_Mode(void)
+{
+	return fft_mode;
+}
+
+#ifdef BENCH_FFT
+/*
+ * On-target cycle counts (TIM2 at 48 MHz), build with -DBENCH_FFT:
+ * printed once at startup for each stage of FFT_Window() on a test tone,
+ * the whole call is also in the "FFT window" timing statistics.
+ */
+#include "stats.h"
+
+extern int stm32_printf(const char *format, ...);
+
+void FFT_Benchmark(void)
+{
+	// 7 periods in the window, 400 codes peak
+	for (uint32_t k = 0; k < FFT_N; ++k)
+	{
+		adc_acq_data[k] = (uint16_t) (512 + ((400 * fix_sin_table[(7 * k) & (FFT_N - 1)]) >> 15));
+	}
+
+	FFT_Reset();
+	const uint32_t t0 = STATS_Now();
+	const uint32_t peak = FFT_Load(acq_work.fft.buffer.z);
+	const uint32_t t1 = STATS_Now();
+	const uint32_t exponent = FFT_Complex(acq_work.fft.buffer.z, peak);
+	const uint32_t t2 = STATS_Now();
+	FFT_Magnitude(acq_work.fft.buffer.z, exponent);
+	const uint32_t t3 = STATS_Now();
+	FFT_Reset();
+
+	stm32_printf("[FFT]: cycles, window and bit reversal: %d, %d-point complex FFT: %d, magnitudes: %d, total: %d\r\n",
+			t1 - t0, FFT_M, t2 - t1, t3 - t2, t3 - t0);
+}
+#endif
+
+#ifdef TEST_FFT
+/*
+ * Host accuracy check against a double precision DFT, build with
+ *   gcc -O2 -DTEST_FFT -Iapp/inc -Icmsis/core -Icmsis/device/inc app/src/fft.c app/src/fixmath.c -lm
+ */
+#include <stdio.h>
+#include <math.h>
+
+uint16_t adc_acq_data[ADC_ACQ_DATA_SIZE];
+union ACQ_Work acq_work;
+
+int main(void)
+{
+	static const double cycles[] = {3.0, 7.0, 7.37, 31.5, 100.2, 127.0};
+	static const double amplitude[] = {500.0, 100.0, 3.0};
+	FFT_Set_Mode(FFT_LAST);
+
+	for (uint32_t a = 0; a < sizeof(amplitude) / sizeof(amplitude[0]); ++a)
+	{
+		for (uint32_t c = 0; c < sizeof(cycles) / sizeof(cycles[0]); ++c)
+		{
+			uint32_t seed = 1;
+			double x[FFT_N], mean = 0;
+			for (uint32_t k = 0; k < FFT_N; ++k)
+			{
+				// Tone, 2nd harmonic at -40 dBc and 1 LSB of dither
+				seed = seed * 1664525u + 1013904223u;
+				const double t = 2 * M_PI * cycles[c] * k / FFT_N;
+				const double v = 512 + amplitude[a] * (sin(t) + 0.01 * sin(2 * t + 1)) + (seed >> 8) / 16777216.0 - 0.5;
+				adc_acq_data[k] = (uint16_t) floor(v + 0.5);
+				x[k] = adc_acq_data[k];
+				mean += x[k] / FFT_N;
+			}
+			FFT_Window();
+			struct FFT_Result r;
+			FFT_Get_Result(&r);
+
+			// Reference levels of the same windowed samples, error of the bins 20 dB above the
+			// quantization floor of the 10-bit samples (-81 dBFS per bin)
+			double err = 0;
+			for (uint32_t k = 0; k < FFT_N_BINS; ++k)
+			{
+				double re = 0, im = 0;
+				for (uint32_t n = 0; n < FFT_N; ++n)
+				{
+					const double w = 0.5 - 0.5 * cos(2 * M_PI * n / FFT_N);
+					re += (x[n] - mean) * w * cos(2 * M_PI * k * n / FFT_N);
+					im -= (x[n] - mean) * w * sin(2 * M_PI * k * n / FFT_N);
+				}
+				const double ref = 20 * log10(hypot(re, im) / (512.0 * FFT_N / 4));
+				if (ref > -60 && fabs(acq_work.fft.buffer.level[k] / 100.0 - ref) > err) err = fabs(acq_work.fft.buffer.level[k] / 100.0 - ref);
+			}
+			printf("%5.1f codes, %6.2f cycles: peak bin %3u %7.2f dBFS, spur bin %3u %7.2f dBc, floor %7.2f dBFS, max error %.3f dB\n",
+					amplitude[a], cycles[c], r.peak_bin, r.peak / 100.0, r.spur_bin, r.spur / 100.0, r.floor / 100.0, err);
+		}
+	}
+	return 0;
+}
+#endif
@@ -0,0 +1,427 @@
+/*
+ * fixmath.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "fixmath.h"
+
+// log10(1 + i/32) in Q16, i = 0..32
+#define LOG10_TABLE_BITS 5
+static const uint16_t log10_table[(1 << LOG10_TABLE_BITS) + 1] =
+{
+	0, 876, 1725, 2551, 3352, 4132, 4891, 5631,
+	6351, 7054, 7740, 8409, 9064, 9703, 10329, 10941,
+	11540, 12127, 12702, 13266, 13818, 14361, 14893, 15415,
+	15928, 16432, 16927, 17413, 17891, 18362, 18825, 19280,
+	19728,
+};
+
+int32_t FIX_Log10(const uint32_t x)
+{
+	// x = 2^e * m with m in [1, 2): log10(x) = e * log10(2) + log10(m)
+	// No CLZ on the Cortex-M0: the most significant bit is found in 5 steps
+	if (x == 0) return FIX_LOG10_ZERO;
+
+	uint32_t m = x;
+	int32_t e = 31;
+	if ((m & 0xFFFF0000) == 0) { m <<= 16; e -= 16; }
+	if ((m & 0xFF000000) == 0) { m <<= 8; e -= 8; }
+	if ((m & 0xF0000000) == 0) { m <<= 4; e -= 4; }
+	if ((m & 0xC0000000) == 0) { m <<= 2; e -= 2; }
+	if ((m & 0x80000000) == 0) { m <<= 1; e -= 1; }
+
+	// Fraction of m (31 bits): table index in the top 5 bits, linear interpolation on the next 16
+	const uint32_t index = (m >> (31 - LOG10_TABLE_BITS)) & ((1 << LOG10_TABLE_BITS) - 1);
+	const uint32_t frac = (m >> (31 - LOG10_TABLE_BITS - 16)) & 0xFFFF;
+	const uint32_t lo = log10_table[index];
+	const uint32_t hi = log10_table[index + 1];
+
+	// Error is below 2.5e-4 (0.005 dB), mostly from FIX_LOG10_2 rounding
+	return e * FIX_LOG10_2 + (int32_t) (lo + (((hi - lo) * frac) >> 16));
+}
+
+int32_t FIX_dB(const uint32_t x, const uint32_t ref)
+{
+	// 20 * log10(x / ref) in hundredths of dB, both must be non-zero
+	const int32_t diff = FIX_Log10(x) - FIX_Log10(ref);
+
+	// |diff| < 10 * 65536 for 32-bit inputs: diff * 2000 fits in 32 bits
+	const int32_t centi = diff * 2000;
+	return (centi >= 0) ? (centi + FIX_Q16_ONE / 2) >> 16 : -((-centi + FIX_Q16_ONE / 2) >> 16);
+}
+
+const int16_t fix_sin_table[1 << FIX_SIN_TABLE_BITS] =
+{
+	0, 804, 1608, 2411, 3212, 4011, 4808, 5602, 6393, 7180, 7962, 8740, 9512, 10279, 11039, 11793,
+	12540, 13279, 14010, 14733, 15447, 16151, 16846, 17531, 18205, 18868, 19520, 20160, 20788, 21403, 22006, 22595,
+	23170, 23732, 24279, 24812, 25330, 25833, 26320, 26791, 27246, 27684, 28106, 28511, 28899, 29269, 29622, 29957,
+	30274, 30572, 30853, 31114, 31357, 31581, 31786, 31972, 32138, 32286, 32413, 32522, 32610, 32679, 32729, 32758,
+	32767, 32758, 32729, 32679, 32610, 32522, 32413, 32286, 32138, 31972, 31786, 31581, 31357, 31114, 30853, 30572,
+	30274, 29957, 29622, 29269, 28899, 28511, 28106, 27684, 27246, 26791, 26320, 25833, 25330, 24812, 24279, 23732,
+	23170, 22595, 22006, 21403, 20788, 20160, 19520, 18868, 18205, 17531, 16846, 16151, 15447, 14733, 14010, 13279,
+	12540, 11793, 11039, 10279, 9512, 8740, 7962, 7180, 6393, 5602, 4808, 4011, 3212, 2411, 1608, 804,
+	0, -804, -1608, -2411, -3212, -4011, -4808, -5602, -6393, -7180, -7962, -8740, -9512, -10279, -11039, -11793,
+	-12540, -13279, -14010, -14733, -15447, -16151, -16846, -17531, -18205, -18868, -19520, -20160, -20788, -21403, -22006, -22595,
+	-23170, -23732, -24279, -24812, -25330, -25833, -26320, -26791, -27246, -27684, -28106, -28511, -28899, -29269, -29622, -29957,
+	-30274, -30572, -30853, -31114, -31357, -31581, -31786, -31972, -32138, -32286, -32413, -32522, -32610, -32679, -32729, -32758,
+	-32768, -32758, -32729, -32679, -32610, -32522, -32413, -32286, -32138, -31972, -31786, -31581, -31357, -31114, -30853, -30572,
+	-30274, -29957, -29622, -29269, -28899, -28511, -28106, -27684, -27246, -26791, -26320, -25833, -25330, -24812, -24279, -23732,
+	-23170, -22595, -22006, -21403, -20788, -20160, -19520, -18868, -18205, -17531, -16846, -16151, -15447, -14733, -14010, -13279,
+	-12540, -11793, -11039, -10279, -9512, -8740, -7962, -7180, -6393, -5602, -4808, -4011, -3212, -2411, -1608, -804,
+};
+
+// CORDIC: atan(2^-i) in pi / 2^28 units
+#define CORDIC_ITERATIONS 16
+#define CORDIC_PI (1 << 28)
+static const int32_t cordic_atan[CORDIC_ITERATIONS] =
+{
+	67108864, 39616676, 20932363, 10625595,
+	5333416, 2669308, 1334980, 667531,
+	333770, 166886, 83443, 41722,
+	20861, 10430, 5215, 2608,
+};
+
+// 1 / CORDIC gain (0.607253) in Q15
+#define CORDIC_K_Q15 19898
+
+void FIX_Polar(int32_t x, int32_t y, uint32_t* magnitude, int32_t* angle)
+{
+	// Vectoring mode: (x, y) is rotated onto the x axis by +-atan(2^-i) steps,
+	// shifts and adds only. |x| and |y| must stay below 2^31
+	int32_t a = 0;
+
+	if (x == 0 && y == 0)
+	{
+		*magnitude = 0;
+		*angle = 0;
+		return;
+	}
+
+	// Left half plane: rotate by pi first, CORDIC converges for |angle| < 1.74 rad
+	if (x < 0)
+	{
+		x = -x;
+		y = -y;
+		a = CORDIC_PI;
+	}
+
+	// Largest component in [2^28, 2^29): the CORDIC gain (1.65) times sqrt(2) stays below 2^31
+	uint32_t m = (uint32_t) x | (uint32_t) (y < 0 ? -y : y);
+	int32_t shift = 0;
+	while (m >= (1u << 29)) { m >>= 1; ++shift; }
+	while (m < (1u << 20)) { m <<= 8; shift -= 8; }
+	while (m < (1u << 28)) { m <<= 1; --shift; }
+
+	if (shift > 0) { x >>= shift; y >>= shift; }
+	else { x <<= -shift; y <<= -shift; }
+
+	for (uint32_t i = 0; i < CORDIC_ITERATIONS; ++i)
+	{
+		const int32_t xs = x >> i;
+		const int32_t ys = y >> i;
+		if (y > 0)
+		{
+			x += ys;
+			y -= xs;
+			a += cordic_atan[i];
+		}
+		else
+		{
+			x -= ys;
+			y += xs;
+			a -= cordic_atan[i];
+		}
+	}
+
+	// Gain correction on 17 bits of x: (x / 2^14) * (K * 2^15) / 2
+	uint32_t mag = (((uint32_t) x >> 14) * CORDIC_K_Q15) >> 1;
+	if (shift > 0) mag <<= shift;
+	else mag = (mag + ((1u << -shift) >> 1)) >> -shift;
+	*magnitude = mag;
+
+	// pi / 2^28 to pi / 2^15 units, wrapped to [-pi, pi)
+	int32_t r = (a + (1 << 12)) >> 13;
+	if (r >= FIX_ANGLE_PI) r -= 2 * FIX_ANGLE_PI;
+	*angle = r;
+}
+
+int32_t FIX_Atan2(const int32_t y, const int32_t x)
+{
+	uint32_t magnitude;
+	int32_t angle;
+	FIX_Polar(x, y, &magnitude, &angle);
+	return angle;
+}
+
+uint32_t FIX_Magnitude(const int32_t x, const int32_t y)
+{
+	uint32_t magnitude;
+	int32_t angle;
+	FIX_Polar(x, y, &magnitude, &angle);
+	return magnitude;
+}
+
+// Rotation mode CORDIC: atan(2^-i) in turn / 2^32 units, and its gain in Q30
+#define SINCOS_ITERATIONS 24
+#define SINCOS_K_Q30 652032874
+static const int32_t sincos_atan[SINCOS_ITERATIONS] =
+{
+	536870912, 316933406, 167458907, 85004756,
+	42667331, 21354465, 10679838, 5340245,
+	2670163, 1335087, 667544, 333772,
+	166886, 83443, 41722, 20861,
+	10430, 5215, 2608, 1304,
+	652, 326, 163, 81,
+};
+
+void FIX_Sincos(const uint32_t phase, int32_t* c, int32_t* s)
+{
+	// (K, 0) is rotated by the phase (2^32 = one turn) with shifts and adds,
+	// cos and sin in Q30, for coefficients finer than the FIX_SIN table
+	int32_t a = (int32_t) phase;
+	int32_t sign = 1;
+
+	// Left half plane: rotate by pi, CORDIC converges for |angle| < 1.74 rad
+	if (a > 0x40000000 || a < -0x40000000)
+	{
+		a -= (int32_t) 0x80000000;
+		sign = -1;
+	}
+
+	int32_t x = SINCOS_K_Q30;
+	int32_t y = 0;
+	for (uint32_t i = 0; i < SINCOS_ITERATIONS; ++i)
+	{
+		const int32_t xs = x >> i;
+		const int32_t ys = y >> i;
+		if (a >= 0)
+		{
+			x -= ys;
+			y += xs;
+			a -= sincos_atan[i];
+		}
+		else
+		{
+			x += ys;
+			y -= xs;
+			a += sincos_atan[i];
+		}
+	}
+
+	*c = sign * x;
+	*s = sign * y;
+}
+
+uint16_t FIX_Sqrt(uint32_t x)
+{
+	// Floor of the square root, one result bit per step (no multiply)
+	uint32_t r = 0;
+	uint32_t bit = 1u << 30;
+
+	while (bit > x) bit >>= 2;
+	while (bit)
+	{
+		if (x >= r + bit)
+		{
+			x -= r + bit;
+			r = (r >> 1) + bit;
+		}
+		else
+		{
+			r >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (uint16_t) r;
+}
+
+// 1 / (0.5 + (i + 0.5) / 32) in Q15: first guess for the reciprocal of a mantissa in [0.5, 1)
+#define RECIPROCAL_TABLE_BITS 4
+static const uint16_t reciprocal_table[1 << RECIPROCAL_TABLE_BITS] =
+{
+	63550, 59919, 56680, 53773, 51150, 48771, 46603, 44620,
+	42799, 41121, 39569, 38130, 36792, 35545, 34380, 33288,
+};
+
+uint32_t FIX_Reciprocal(const uint32_t x, uint8_t* shift)
+{
+	// 1/x ~= result / 2^shift, result in [2^31, 2^32)
+	// x = m / 2^s with m in [2^31, 2^32) (mantissa 0.5 to 1 in Q32)
+	uint32_t m = x;
+	uint32_t s = 0;
+	if (x == 0)
+	{
+		*shift = 0;
+		return 0xFFFFFFFF;
+	}
+	while ((m & 0xFF000000) == 0) { m <<= 8; s += 8; }
+	while ((m & 0x80000000) == 0) { m <<= 1; ++s; }
+
+	// Table guess (3% error), then Newton-Raphson y = y * (2 - m * y): 1e-3, 1e-6, full precision
+	uint32_t y = (uint32_t) reciprocal_table[(m >> (31 - RECIPROCAL_TABLE_BITS)) & ((1 << RECIPROCAL_TABLE_BITS) - 1)] << 16;
+	for (uint32_t i = 0; i < 3; ++i)
+	{
+		const uint32_t p = (uint32_t) (((uint64_t) m * y) >> 32);	// m * y in Q31, close to 1
+		const uint64_t next = ((uint64_t) y * (0u - p)) >> 31;		// 2 - m * y in Q31
+
+		// 1/0.5 = 2.0 does not fit: saturated for a power of two
+		y = (next > 0xFFFFFFFF) ? 0xFFFFFFFF : (uint32_t) next;
+	}
+
+	*shift = (uint8_t) (63 - s);
+	return y;
+}
+
+uint32_t FIX_Div(const uint32_t num, const uint32_t den)
+{
+	// num / den rounded down, multiply by the reciprocal instead of __aeabi_uidiv
+	uint8_t shift;
+	const uint32_t r = FIX_Reciprocal(den, &shift);
+	if (den == 0) return 0xFFFFFFFF;
+
+	uint32_t q = (uint32_t) (((uint64_t) num * r) >> shift);
+
+	// The reciprocal is within a few units of its last bit: the quotient may be off by 2
+	int64_t rem = (int64_t) num - (int64_t) ((uint64_t) q * den);
+	while (rem < 0) { --q; rem += den; }
+	while (rem >= den) { ++q; rem -= den; }
+	return q;
+}
+
+#ifdef BENCH_FIXMATH
+/*
+ * On-target cycle counts (TIM2 at 48 MHz), build with -DBENCH_FIXMATH:
+ * printed once at startup, to size the per-period processing against the
+ * TIM15 overflow period (min slack of the throughput envelope).
+ */
+#include "stats.h"
+
+extern int stm32_printf(const char *format, ...);
+
+#define BENCH_N 64
+
+void FIX_Benchmark(void)
+{
+	static const char* name[] = {"FIX_Polar", "FIX_Log10", "FIX_Sqrt", "FIX_Div", "__aeabi_uidiv"};
+	volatile uint32_t sink = 0;
+	uint32_t u = 0x9E3779B9;
+	uint32_t cycles[5] = {0};
+
+	for (uint32_t n = 0; n < BENCH_N; ++n)
+	{
+		uint32_t magnitude;
+		int32_t angle;
+		u = u * 1664525 + 1013904223;
+		const uint32_t v = (u >> 8) + 1;
+
+		// Minimum of one call (no interrupt in between)
+		uint32_t t[6];
+		t[0] = STATS_Now();
+		FIX_Polar((int16_t) u, (int16_t) (u >> 16), &magnitude, &angle);
+		t[1] = STATS_Now();
+		sink ^= FIX_Log10(v);
+		t[2] = STATS_Now();
+		sink ^= FIX_Sqrt(u);
+		t[3] = STATS_Now();
+		sink ^= FIX_Div(u, v >> (n & 15));
+		t[4] = STATS_Now();
+		sink ^= u / (v >> (n & 15));
+		t[5] = STATS_Now();
+		sink ^= magnitude ^ angle;
+
+		for (uint32_t k = 0; k < 5; ++k)
+		{
+			if (n == 0 || t[k + 1] - t[k] < cycles[k]) cycles[k] = t[k + 1] - t[k];
+		}
+	}
+
+	stm32_printf("[FIXMATH]: cycles per call (min of %d, timer read included)\r\n", BENCH_N);
+	for (uint32_t k = 0; k < 5; ++k)
+	{
+		stm32_printf("%s: %d\r\n", name[k], cycles[k]);
+	}
+}
+#endif
+
+#ifdef TEST_FIXMATH
+/*
+ * Host accuracy check against libm, build with
+ *   gcc -O2 -DTEST_FIXMATH -Iapp/inc app/src/fixmath.c -lm
+ * Host nanoseconds per call are printed as well, cycle counts on the
+ * Cortex-M0 come from the BENCH_FIXMATH build.
+ */
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#define TEST_N 1000000
+
+static double now_ns(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+int main(void)
+{
+	uint32_t u = 1;
+	double err_angle = 0, err_mag = 0, err_log = 0, err_sincos = 0;
+	uint32_t sqrt_errors = 0, div_errors = 0;
+
+	for (uint32_t n = 0; n < TEST_N; ++n)
+	{
+		uint32_t magnitude;
+		int32_t angle;
+		u = u * 1664525u + 1013904223u;
+
+		// Components of all sizes, up to +-2^30
+		const int32_t x = (int32_t) (u << (n & 15)) >> (1 + (n & 15) + (n & 7));
+		const int32_t y = (int32_t) (u * 2654435761u) >> (1 + (n & 15));
+		if (x == 0 && y == 0) continue;
+
+		FIX_Polar(x, y, &magnitude, &angle);
+		const double ref_mag = hypot(x, y);
+		double da = angle * M_PI / FIX_ANGLE_PI - atan2(y, x);
+		if (da > M_PI) da -= 2 * M_PI;
+		if (da < -M_PI) da += 2 * M_PI;
+		if (fabs(da) > err_angle) err_angle = fabs(da);
+		if (ref_mag >= 65536 && fabs(magnitude - ref_mag) / ref_mag > err_mag) err_mag = fabs(magnitude - ref_mag) / ref_mag;
+
+		const double dl = fabs(FIX_Log10(u | 1) / 65536.0 - log10(u | 1));
+		if (dl > err_log) err_log = dl;
+
+		if (FIX_Sqrt(u) != (uint32_t) floor(sqrt((double) u))) ++sqrt_errors;
+
+		int32_t c, si;
+		FIX_Sincos(u, &c, &si);
+		const double ds = fmax(fabs(c / 1073741824.0 - cos(u * M_PI / 2147483648.0)),
+				fabs(si / 1073741824.0 - sin(u * M_PI / 2147483648.0)));
+		if (ds > err_sincos) err_sincos = ds;
+
+		const uint32_t den = (u >> (n & 31)) | 1;
+		if (FIX_Div(u * 2654435761u, den) != (u * 2654435761u) / den) ++div_errors;
+	}
+
+	printf("atan2: max error %.2e rad (%.4f deg)\n", err_angle, err_angle * 180 / M_PI);
+	printf("magnitude: max relative error %.2e (|v| >= 65536, the result is an integer)\n", err_mag);
+	printf("log10: max error %.2e (%.4f dB)\n", err_log, 20 * err_log);
+	printf("sincos: max error %.2e\n", err_sincos);
+	printf("sqrt: %u mismatches, div: %u mismatches\n", sqrt_errors, div_errors);
+
+	volatile uint32_t sink = 0;
+	double t0 = now_ns();
+	for (uint32_t n = 0; n < TEST_N; ++n) { uint32_t m; int32_t a; FIX_Polar(n - TEST_N / 2, n * 7, &m, &a); sink ^= m ^ a; }
+	double t1 = now_ns();
+	for (uint32_t n = 1; n <= TEST_N; ++n) sink ^= FIX_Log10(n);
+	double t2 = now_ns();
+	for (uint32_t n = 0; n < TEST_N; ++n) sink ^= FIX_Sqrt(n * 4099);
+	double t3 = now_ns();
+	for (uint32_t n = 1; n <= TEST_N; ++n) sink ^= FIX_Div(0xFFFFFFFF - n, n);
+	double t4 = now_ns();
+	printf("host ns/call: polar %.1f, log10 %.1f, sqrt %.1f, div %.1f\n",
+			(t1 - t0) / TEST_N, (t2 - t1) / TEST_N, (t3 - t2) / TEST_N, (t4 - t3) / TEST_N);
+	return 0;
+}
+#endif
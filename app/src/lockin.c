@@ -0,0 +1,139 @@
+/*
+ * lockin.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "lockin.h"
+#include "fixmath.h"
+#include "adc.h"
+#include "stm32f0xx.h"
+
+// declared in adc.c
+extern uint16_t adc_acq_data[ADC_ACQ_DATA_SIZE];
+
+// declared in timer.c
+extern uint16_t previous_divide_by;
+
+// ADC sample period in CPU cycles for each SMPR value: PCLK /2 clock, 10-bit conversion
+// (sampling time + 10.5 cycles, continuous mode)
+static const uint16_t sample_cycles[8] = {24, 36, 48, 78, 104, 132, 164, 500};
+
+// Windows start on the same PB14 edge: the sums of successive windows add up coherently
+// while the noise only grows as the square root of their number
+static int64_t sum_i = 0;		// sum of x * cos
+static int64_t sum_q = 0;		// sum of x * sin
+static uint32_t n_samples = 0;
+static uint32_t n_windows = 0;
+static uint32_t n_rejected = 0;
+
+static uint8_t lockin_enable = 0;
+
+void LOCKIN_Reset(void)
+{
+	sum_i = 0;
+	sum_q = 0;
+	n_samples = 0;
+	n_windows = 0;
+	n_rejected = 0;
+}
+
+uint32_t LOCKIN_Phase_Step(const uint16_t capture)
+{
+	// Signal phase step per ADC sample, 2^32 = one turn: sample time / signal period,
+	// the capture spans divide-by +1 signal periods of the TIM1 clock (psc cycles per count)
+	// 0 if the period is unknown or the signal is above fs/2
+	const uint32_t psc = TIM1->PSC + 1;
+	const uint32_t period = (uint32_t) capture * psc;
+	if (period == 0) return 0;
+
+	uint8_t shift;
+	const uint32_t r = FIX_Reciprocal(period, &shift);
+	const uint32_t a = (uint32_t) sample_cycles[ADC1->SMPR & ADC_SMPR_SMP_Msk] * (previous_divide_by + 1);
+	const uint64_t step = ((uint64_t) a * r) >> (shift - 32);
+
+	return (step >= 0x80000000) ? 0 : step;
+}
+
+void LOCKIN_Window(const uint16_t capture)
+{
+	// Called from the bottom half with the window of the period in adc_acq_data,
+	// capture is the TIM1 count of the same period
+	const uint32_t step = LOCKIN_Phase_Step(capture);
+
+	// Only whole signal periods are integrated (the reference sums to zero over them)
+	const uint32_t n_periods = (uint32_t) (((uint64_t) step * ADC_ACQ_DATA_SIZE) >> 32);
+	if (n_periods == 0)
+	{
+		++n_rejected;
+		return;
+	}
+
+	// First pass: samples in n_periods signal periods, and their mean
+	uint32_t phase = 0;
+	uint32_t turns = 0;
+	uint32_t sum_x = 0;
+	uint32_t n = 0;
+	while (n < ADC_ACQ_DATA_SIZE)
+	{
+		sum_x += adc_acq_data[n++];
+		const uint32_t next = phase + step;
+		if (next < phase && ++turns == n_periods) break;
+		phase = next;
+	}
+
+	// DC is removed with 1/16 code resolution, it would leak through the partial last sample
+	const int32_t mean = (int32_t) FIX_Div(sum_x << 4, n);
+
+	// Second pass: mix with the references, (x - mean) * 16 * Q15 fits in 30 bits
+	// Half a table step: the table index is rounded instead of truncated (no phase bias)
+	phase = 1u << (31 - FIX_SIN_TABLE_BITS);
+	for (uint32_t k = 0; k < n; ++k)
+	{
+		const int32_t x = ((int32_t) adc_acq_data[k] << 4) - mean;
+		sum_i += x * FIX_COS(phase);
+		sum_q += x * FIX_SIN(phase);
+		phase += step;
+	}
+
+	n_samples += n;
+	++n_windows;
+}
+
+uint8_t LOCKIN_Get_Result(struct LOCKIN_Result* result)
+{
+	// Main loop, once the run is over
+	result->windows = n_windows;
+	result->samples = n_samples;
+	result->rejected = n_rejected;
+	if (n_samples == 0) return 0;
+
+	// CORDIC inputs must stay below 2^31
+	int64_t i = sum_i;
+	int64_t q = sum_q;
+	uint32_t s = 0;
+	while (i >= (1LL << 30) || i <= -(1LL << 30) || q >= (1LL << 30) || q <= -(1LL << 30))
+	{
+		i >>= 1;
+		q >>= 1;
+		++s;
+	}
+
+	// x = A * sin(wt + phase): sum of x * sin = A * n / 2 * cos(phase), sum of x * cos = A * n / 2 * sin(phase)
+	uint32_t magnitude;
+	FIX_Polar((int32_t) q, (int32_t) i, &magnitude, &result->phase);
+
+	// A = 2 * magnitude / n, magnitude scaled by 16 (mean resolution) and 2^15 (Q15), x100
+	result->amplitude = (uint32_t) ((((uint64_t) magnitude << s) * 200) / ((uint64_t) n_samples << 19));
+	return 1;
+}
+
+inline void LOCKIN_Set_Enable(const uint8_t enable)
+{
+	lockin_enable = enable;
+}
+
+inline uint8_t LOCKIN_Get_Enable(void)
+{
+	return lockin_enable;
+}
@@ -8,27 +8,51 @@
 #include "uart.h"
 #include "timer.h"
 #include "adc.h"
+#include "dump.h"
+#include "usb_cdc.h"
+#include "transport.h"
+#include "event.h"
+#include "acq.h"
+#include "record.h"
+#include "tick.h"
+#include "stats.h"
+#include "trace.h"
+#include "envelope.h"
+#include "bode.h"
+#include "fixmath.h"
+#include "lockin.h"
+#include "average.h"
+#include "thd.h"
+#include "peak.h"
+#include "fft.h"
+#include "outlier.h"
+#include "summary.h"
 #include "stm32f0xx.h"
 
 extern int stm32_printf(const char *format, ...);
 extern int stm32_sprintf(char *out, const char *format, ...);
 
-// declared in timer.c
-extern uint16_t timer_cnt[TIMER_CNT_SIZE];
-
-// declared in adc.c
-extern uint16_t adc_max_data[ADC_MAX_DATA_SIZE];
+// Bin width in hundredths of Hz times the ADC sample period in CPU cycles: 48 MHz * 100 / FFT_N
+#define FFT_BIN_CENTI_HZ 18750000
 
 enum Menu_State
 {
 	ROOT = 0,
 	TIMER_CONF,
 	ADC_CONF,
+	STATS_VIEW,
+	BODE_CONF,
+	SUMMARY_VIEW,
 	INPUT_TIM_PSC, // for entering numbers
 	INPUT_ADC_SMP,
 	INPUT_TIM_FDIV,
+	INPUT_BODE_REF,
+	INPUT_TOLERANCE,
+	INPUT_MIN_PERIODS,
+	INPUT_MAX_PERIODS,
 	ACQ_DONE,
 	ACQ_RUNNING,
+	ENVELOPE_RUNNING,
 };
 
 struct Input_Number
@@ -43,18 +67,27 @@ static void SystemClock_Config(void);
 static void Print_Root_Menu(void);
 static void Print_Timer_Menu(void);
 static void Print_ADC_Menu(void);
+static void Print_Stats_Menu(void);
+static void Print_Bode_Menu(void);
+static void Print_Summary_Menu(void);
+static void Print_Summary_Point(const uint32_t i, const struct SUM_Point* p);
+static void Handle_Run_Key(const uint8_t key);
 static uint8_t is_number(const uint8_t ascii);
 static void Clear_Input_Number(struct Input_Number* in);
 static enum Menu_State Get_Input(uint8_t key, struct Input_Number* in);
 static void Print_ACQ_DONE_Info(void);
+static void Print_Bode_Row(void);
+static void Print_ACQ_Timeout(void);
+static void Dump_Trace(void);
+static void Print_Envelope(void);
+static void Handle_Key(const uint8_t key, struct Input_Number* in);
+static void Print_Menu(void);
 
 enum Menu_State menu_state = ROOT;
+enum Dump_Mode dump_mode = DUMP_TEXT;
 
-// Variables modified by ISRs
-volatile uint8_t current_key = 0;
-volatile uint8_t is_new_key = 1;
-volatile uint8_t adc_acq_data_filled = 0;
-volatile uint8_t error_flag = 0;
+// Time of the EVT_ACQ_DONE event of the last run
+uint64_t acq_done_time = 0;
 
 const uint8_t adc_smp[] = {1, 7, 13, 28, 41, 55, 71, 239};
 
@@ -65,8 +98,12 @@ int main(void)
 
 	// Configure peripherals
 	UART_Init();
+	UART_DMA_Init();
 	stm32_printf("UART initialized\r\n");
 
+	USB_CDC_Init();
+	stm32_printf("USB CDC initialized\r\n");
+
 	TIMER_FDIV_Init();
 	TIMER_IC_Init();
 	stm32_printf("TIMER initialized\r\n");
@@ -74,154 +111,104 @@ int main(void)
 	ADC_Init();
 	stm32_printf("ADC initialized and calibrated\r\n");
 
+	// Time base first, stats use its timer
+	TICK_Init();
+	STATS_Init();
+
+#ifdef BENCH_FIXMATH
+	// Cycles per call of the fixed-point routines
+	FIX_Benchmark();
+#endif
+#ifdef BENCH_FFT
+	// Cycles per stage of the window FFT
+	FFT_Benchmark();
+#endif
+
 	// Enable interrupts
+	EVENT_Init();
 	UART_NVIC_Init();
+	UART_DMA_NVIC_Init();
+	USB_CDC_NVIC_Init();
 	TIMER_FDIV_NVIC_Init();
 	TIMER_IC_NVIC_Init();
+	ADC_NVIC_Init();
 
 	struct Input_Number input_number;
 	Clear_Input_Number(&input_number);
 
-	uint8_t acq_running = 1;
+	struct Event evt;
+
+	// Print ROOT menu
+	EVENT_Post(EVT_KEY, 0);
 
 	while(1)
 	{
-		// Check for general errors
-		if (error_flag)
-		{
-			stm32_printf("\r\nProgram encountered an error. Please hard-reset the CPU ");
-			while(1){}
-		}
-		// flag set when all ADC data for 1 max sample is collected
-		if (adc_acq_data_filled)
-		{
-			// Stop ADC
-			ADC_ACQ_Disable();
-
-			// calculate max ADC value and copy to buffer
-			acq_running = ADC_Update_Max_Data();
-
-			// Enable ADC for next samples
-			ADC_ACQ_Enable();
-
-			// clear flag
-			adc_acq_data_filled = 0;
-		}
-
-		// flag is zero when total acquisition is completed without errors
-		if (acq_running == 0)
-		{
-			menu_state = ACQ_DONE;
-
-			TIMER_IC_ACQ_Disable();
-			ADC_ACQ_Disable();
-
-			// Change flag so we do not execute this portion over and over again
-			acq_running = 1;
-		}
-		else if (is_new_key == 0)
+		// Sleep until an ISR posts an event
+		if (!EVENT_Get(&evt))
 		{
+			EVENT_Wait();
 			continue;
 		}
 
-		is_new_key = 0;
-
-		// Parse input
-		switch(menu_state)
+		switch(evt.id)
 		{
-		case ROOT:
-			if(current_key == 't') menu_state = TIMER_CONF;
-			else if(current_key == 'a') menu_state = ADC_CONF;
-			else if(current_key == 's')
-			{
-				UART_RXINT_Disable();
-				TIMER_IC_ACQ_Enable();
-				ADC_ACQ_Enable();
-
-				menu_state = ACQ_RUNNING;
-			}
+		case EVT_RECORD:
+			ACQ_Consume();
 			break;
-		case TIMER_CONF:
-			if(current_key == 'r') menu_state = ROOT;
-			else if(current_key == 'p')
+		case EVT_ACQ_DONE:
+			// Posted once the ADC is off after the last period (arg = run id)
+			// An aborted or restarted run is not reported
+			if (evt.arg != ACQ_Run_Id()) break;
+			// Records of the last periods may still be in the ring
+			ACQ_Consume();
+			if (menu_state == ENVELOPE_RUNNING)
 			{
-				menu_state = INPUT_TIM_PSC;
-				stm32_printf("\r\nEnter TIM1->PSC followed by <ENTER>: ");
-			}
-			else if (current_key == 'f')
-			{
-				menu_state = INPUT_TIM_FDIV;
-				stm32_printf("\r\nEnter TIM15->ARR followed by <ENTER>: ");
+				// Next point, or the table at the end of the sweep
+				if (!ENV_Run_Done()) break;
+				Print_Envelope();
+				menu_state = ROOT;
+				Print_Menu();
 			}
-			break;
-		case ADC_CONF:
-			if(current_key == 'r') menu_state = ROOT;
-			else if(current_key == 's')
+			else if (menu_state == ACQ_RUNNING)
 			{
-				menu_state = INPUT_ADC_SMP;
-				stm32_printf("\r\n");
-				for(int i = 0; i < 8; ++i)
+				if (SUM_Get_Enable() && !SUM_End_Point())
 				{
-					stm32_printf("%d for %d,5 ADC clock cycles\r\n", i, adc_smp[i]);
+					stm32_printf("\r\n[WARNING]: summary table full (%d points), point not stored\r\n", SUM_N_POINTS);
 				}
-				stm32_printf("\r\nEnter correct number for ADC1->SMPR: ");
+				acq_done_time = evt.time;
+				menu_state = ACQ_DONE;
+				Print_Menu();
 			}
 			break;
-		case INPUT_TIM_PSC:
-			if(Get_Input(current_key, &input_number))
-			{
-				menu_state = ROOT;
-				TIMER_IC_Set_PSC((uint16_t) input_number.value);
-				Clear_Input_Number(&input_number);
-			}
+		case EVT_ACQ_TIMEOUT:
+			// Posted by SysTick when a stage of the run waited too long (arg = run id)
+			if (evt.arg != ACQ_Run_Id()) break;
+			if (menu_state != ACQ_RUNNING && menu_state != ENVELOPE_RUNNING) break;
+			ACQ_Consume();
+			if (menu_state == ENVELOPE_RUNNING) ENV_Abort();
+			Print_ACQ_Timeout();
+			Dump_Trace();
+			menu_state = ROOT;
+			Print_Menu();
 			break;
-		case INPUT_ADC_SMP:
-			int smpr = current_key - '0';
-			if (smpr >= 0 && smpr <= 7)
+		case EVT_KEY:
+			if (menu_state == ACQ_RUNNING)
 			{
-				ADC_Set_SMPR((uint8_t) smpr);
+				Handle_Run_Key(evt.arg);
+				break;
 			}
-			else
-			{
-				stm32_printf("[ERROR]: value out of range\r\n");
-			}
-			menu_state = ROOT;
-			break;
-		case INPUT_TIM_FDIV:
-			if(Get_Input(current_key, &input_number))
+			if (menu_state == ENVELOPE_RUNNING)
 			{
+				// Any key stops the sweep
+				ENV_Abort();
+				ACQ_Consume();
+				stm32_printf("\r\nCharacterization aborted\r\n");
 				menu_state = ROOT;
-				TIMER_FDIV_Set_CNT((uint16_t) input_number.value);
-				Clear_Input_Number(&input_number);
+				Print_Menu();
+				break;
 			}
-			break;
-		default:
-			break;
-		}
-
-		// Print menus
-		switch(menu_state)
-		{
-		case ROOT:
-			Print_Root_Menu();
-			break;
-		case TIMER_CONF:
-			Print_Timer_Menu();
-			break;
-		case ADC_CONF:
-			Print_ADC_Menu();
-			break;
-		case ACQ_DONE:
-			Print_ACQ_DONE_Info();
-			UART_RXINT_Enable();
-
-			// Set flag to print menu
-			menu_state = ROOT;
-			is_new_key = 1;
-			current_key = 0;
-			break;
-		case ACQ_RUNNING:
-			stm32_printf("\r\nRunning acquisition...\r\n");
+			Handle_Key(evt.arg, &input_number);
+			Print_Menu();
 			break;
 		default:
 			break;
@@ -296,28 +283,309 @@ void SystemClock_Config(void)
 	SystemCoreClockUpdate();
 }
 
+static void Handle_Key(const uint8_t key, struct Input_Number* in)
+{
+	switch(menu_state)
+	{
+	case ROOT:
+		if(key == 't') menu_state = TIMER_CONF;
+		else if(key == 'a') menu_state = ADC_CONF;
+		else if(key == 'i') menu_state = STATS_VIEW;
+		else if(key == 'b') menu_state = BODE_CONF;
+		else if(key == 'u') menu_state = SUMMARY_VIEW;
+		else if(key == 'd')
+		{
+			static const char* dump_mode_str[] = {"text", "compressed", "raw DMA", "Bode row"};
+			dump_mode = (dump_mode == DUMP_BODE) ? DUMP_TEXT : dump_mode + 1;
+			stm32_printf("\r\nDump mode: %s\r\n", dump_mode_str[dump_mode]);
+		}
+		else if(key == 'o')
+		{
+			// Switch output link, keys are accepted from both
+			TRANSPORT_Select((TRANSPORT_Get() == &transport_uart) ? &transport_usb : &transport_uart);
+			stm32_printf("\r\nOutput: %s\r\n", TRANSPORT_Get()->name);
+		}
+		else if((key == 's' || key == 'e') && TRANSPORT_Busy())
+		{
+			// Result arrays are still being read by the DMA
+			stm32_printf("\r\n[ERROR]: previous dump still in progress\r\n");
+		}
+		else if(key == 'e')
+		{
+			// Short runs, result arrays are overwritten
+			ENV_Start();
+			menu_state = ENVELOPE_RUNNING;
+		}
+		else if(key == 's')
+		{
+			// Keys stay enabled to abort or restart the run
+			ACQ_Start();
+
+			menu_state = ACQ_RUNNING;
+		}
+		break;
+	case TIMER_CONF:
+		if(key == 'r') menu_state = ROOT;
+		else if(key == 'p')
+		{
+			menu_state = INPUT_TIM_PSC;
+			stm32_printf("\r\nEnter TIM1->PSC followed by <ENTER>: ");
+		}
+		else if (key == 'f')
+		{
+			menu_state = INPUT_TIM_FDIV;
+			stm32_printf("\r\nEnter TIM15->ARR followed by <ENTER>: ");
+		}
+		else if (key == 'a')
+		{
+			ACQ_Set_Auto_Divide(!ACQ_Get_Auto_Divide());
+		}
+		else if (key == 'o')
+		{
+			OUTLIER_Set_Enable(!OUTLIER_Get_Enable());
+		}
+		break;
+	case ADC_CONF:
+		if(key == 'r') menu_state = ROOT;
+		else if(key == 'l') LOCKIN_Set_Enable(!LOCKIN_Get_Enable());
+		else if(key == 'v')
+		{
+			// Averaging and spectrum share their memory (acq_work)
+			AVG_Set_Enable(!AVG_Get_Enable());
+			if (AVG_Get_Enable()) FFT_Set_Mode(FFT_OFF);
+		}
+		else if(key == 'h') THD_Set_Enable(!THD_Get_Enable());
+		else if(key == 'p') PEAK_Set_Enable(!PEAK_Get_Enable());
+		else if(key == 'f')
+		{
+			FFT_Set_Mode((FFT_Get_Mode() + 1) % (FFT_LAST + 1));
+			if (FFT_Get_Mode() != FFT_OFF) AVG_Set_Enable(0);
+		}
+		else if(key == 's')
+		{
+			menu_state = INPUT_ADC_SMP;
+			stm32_printf("\r\n");
+			for(int i = 0; i < 8; ++i)
+			{
+				stm32_printf("%d for %d,5 ADC clock cycles\r\n", i, adc_smp[i]);
+			}
+			stm32_printf("\r\nEnter correct number for ADC1->SMPR: ");
+		}
+		break;
+	case STATS_VIEW:
+		if(key == 'r') menu_state = ROOT;
+		else if(key == 'c') STATS_Clear();
+		break;
+	case SUMMARY_VIEW:
+		if(key == 'r') menu_state = ROOT;
+		else if(key == 'm') SUM_Set_Enable(!SUM_Get_Enable());
+		else if(key == 'c') SUM_Clear();
+		else if(key == 't')
+		{
+			menu_state = INPUT_TOLERANCE;
+			stm32_printf("\r\nEnter tolerance in 0.01 %% of the mean (0 = off) followed by <ENTER>: ");
+		}
+		else if(key == 'n')
+		{
+			menu_state = INPUT_MIN_PERIODS;
+			stm32_printf("\r\nEnter minimum number of periods (2 to %d) followed by <ENTER>: ", ACQ_N_PERIODS);
+		}
+		else if(key == 'x')
+		{
+			menu_state = INPUT_MAX_PERIODS;
+			stm32_printf("\r\nEnter maximum number of periods (1 to %d) followed by <ENTER>: ", ACQ_N_PERIODS);
+		}
+		else if(key == 'p')
+		{
+			stm32_printf("\r\n");
+			for (uint32_t i = 0; i < SUM_Get_N_Points(); ++i)
+			{
+				Print_Summary_Point(i, SUM_Get_Point(i));
+			}
+		}
+		break;
+	case BODE_CONF:
+		if(key == 'r') menu_state = ROOT;
+		else if(key == 'a')
+		{
+			menu_state = INPUT_BODE_REF;
+			stm32_printf("\r\nEnter reference amplitude (ADC code, AC peak, 1 to %d) followed by <ENTER>: ", ADC_FULL_SCALE / 2);
+		}
+		break;
+	case INPUT_TIM_PSC:
+		if(Get_Input(key, in))
+		{
+			menu_state = ROOT;
+			TIMER_IC_Set_PSC((uint16_t) in->value);
+			Clear_Input_Number(in);
+		}
+		break;
+	case INPUT_ADC_SMP:
+		int smpr = key - '0';
+		if (smpr >= 0 && smpr <= 7)
+		{
+			// ADC is off between runs: written at once
+			ADC_Async_Set_SMPR((uint8_t) smpr, 0);
+		}
+		else
+		{
+			stm32_printf("[ERROR]: value out of range\r\n");
+		}
+		menu_state = ROOT;
+		break;
+	case INPUT_TIM_FDIV:
+		if(Get_Input(key, in))
+		{
+			menu_state = ROOT;
+			TIMER_FDIV_Set_CNT((uint16_t) in->value);
+			Clear_Input_Number(in);
+		}
+		break;
+	case INPUT_TOLERANCE:
+	case INPUT_MIN_PERIODS:
+	case INPUT_MAX_PERIODS:
+		if(Get_Input(key, in))
+		{
+			struct ACQ_Settings settings;
+			ACQ_Get_Settings(&settings);
+
+			if (menu_state == INPUT_TOLERANCE) settings.tolerance = (uint16_t) in->value;
+			else if (in->value < (menu_state == INPUT_MIN_PERIODS ? 2 : 1) || in->value > ACQ_N_PERIODS)
+			{
+				stm32_printf("[ERROR]: value out of range\r\n");
+			}
+			else if (menu_state == INPUT_MIN_PERIODS) settings.min_periods = (uint16_t) in->value;
+			else settings.n_periods = (uint16_t) in->value;
+
+			// Between runs
+			ACQ_Apply_Settings(&settings);
+			menu_state = SUMMARY_VIEW;
+			Clear_Input_Number(in);
+		}
+		break;
+	case INPUT_BODE_REF:
+		if(Get_Input(key, in))
+		{
+			menu_state = BODE_CONF;
+			if (in->value >= 1 && in->value <= ADC_FULL_SCALE / 2) BODE_Set_Reference((uint16_t) (in->value * 100));
+			else stm32_printf("[ERROR]: value out of range\r\n");
+			Clear_Input_Number(in);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static void Handle_Run_Key(const uint8_t key)
+{
+	struct ACQ_Settings settings;
+	ACQ_Get_Settings(&settings);
+
+	if (key == 'f' && settings.divide_by > 1) settings.divide_by /= 2;
+	else if (key == 'F' && settings.divide_by <= 0x7FFF) settings.divide_by *= 2;
+	else if (key == 'p' && settings.psc > 1) settings.psc /= 2;
+	else if (key == 'P' && settings.psc <= 0x7FFF) settings.psc *= 2;
+	else if (key == 'f' || key == 'F' || key == 'p' || key == 'P')
+	{
+		stm32_printf("\r\n[ERROR]: value out of range\r\n");
+		return;
+	}
+	else
+	{
+		ACQ_Abort();
+		ACQ_Consume();
+		stm32_printf("\r\nAcquisition aborted after %d of %d periods\r\n", ACQ_Records_Received(), settings.n_periods);
+		Dump_Trace();
+
+		menu_state = ROOT;
+		Print_Menu();
+		return;
+	}
+
+	// Records of the previous settings are discarded
+	ACQ_Restart(&settings);
+	stm32_printf("\r\nRestarted with pre-scaler=%d, divide-by=%d\r\n", settings.psc, settings.divide_by);
+}
+
+static void Print_Menu(void)
+{
+	switch(menu_state)
+	{
+	case ROOT:
+		Print_Root_Menu();
+		break;
+	case TIMER_CONF:
+		Print_Timer_Menu();
+		break;
+	case ADC_CONF:
+		Print_ADC_Menu();
+		break;
+	case STATS_VIEW:
+		Print_Stats_Menu();
+		break;
+	case BODE_CONF:
+		Print_Bode_Menu();
+		break;
+	case SUMMARY_VIEW:
+		Print_Summary_Menu();
+		break;
+	case ACQ_DONE:
+		Print_ACQ_DONE_Info();
+		Dump_Trace();
+
+		menu_state = ROOT;
+		if (!TRANSPORT_Busy())
+		{
+			// Print menu
+			EVENT_Post(EVT_KEY, 0);
+		}
+		// else: CPU is free during the DMA dump, menu is printed on next key
+		break;
+	case ENVELOPE_RUNNING:
+		stm32_printf("\r\nCharacterizing throughput envelope (%d periods per point), any key to abort...\r\n", ENV_N_PERIODS);
+		break;
+	case ACQ_RUNNING:
+		stm32_printf("\r\nRunning acquisition...\r\n"
+					 "f / F to halve / double divide-by, p / P to halve / double pre-scaler and restart\r\n"
+					 "any other key to abort\r\n");
+		break;
+	default:
+		break;
+	}
+}
+
 static void Print_Root_Menu(void)
 {
 	static const char* root_menu_str = "t to view / change TIMER configuration\r\n"
 									   "a to view / change ADC configuration\r\n"
+									   "d to change dump mode (text / compressed / raw DMA / Bode row)\r\n"
+									   "o to switch output between UART and USB CDC\r\n"
+									   "i to view timing statistics\r\n"
+									   "b to view / change Bode table reference\r\n"
+									   "u to view / change summary mode (statistics per sweep point)\r\n"
+									   "e to characterize the throughput envelope\r\n"
 									   "s to start acquisition\r\n";
 	stm32_printf("\r\nEnter one of the following keys:\r\n%s=>>", root_menu_str);
 }
 
 static void Print_Timer_Menu(void)
 {
-#define TIMER_FREQ 48e6
+#define TIMER_FREQ 48000000
 	const uint16_t psc = TIM1->PSC + 1;
-	const float f_float = (float) TIMER_FREQ / psc;
-	const uint32_t f_int = (uint32_t) f_float;
 	const uint16_t div_by = (uint16_t) TIM15->ARR;
 
-	// Multiply difference by 100 to have two decimal places
-	const uint32_t f_dec = (f_float - (float) f_int) * 100.f;
-	stm32_printf("\r\n[TIMER CONFIG]:\r\nPrescaler=%d\r\nCounter frequency=%d,%d Hz\r\nDivide-by=%d\r\n", psc, f_int, f_dec, div_by);
+	// Counter frequency in Hz, printed as kHz with three decimals (no float, FIX_Div() instead of __aeabi_uidiv)
+	const uint32_t f_hz = FIX_Div(TIMER_FREQ, psc);
+	stm32_printf("\r\n[TIMER CONFIG]:\r\nPrescaler=%d\r\nCounter frequency=%.3q kHz\r\nDivide-by=%d\r\n", psc, f_hz, div_by);
+
+	stm32_printf("Raise divide-by on overrun=%s\r\n", ACQ_Get_Auto_Divide() ? "on" : "off");
+	stm32_printf("Capture outlier gate=%s\r\n", OUTLIER_Get_Enable() ? "on" : "off");
 
 	static const char* timer_menu_str = "p to change TIMER1 pre-scaler\r\n"
 										"f to change TIMER15 auto-reload value (=divide-by)\r\n"
+										"a to toggle divide-by raise on overrun\r\n"
+										"o to toggle the capture outlier gate (median / MAD of the last captures)\r\n"
 										"r to go back to ROOT menu\r\n";
 	stm32_printf("Enter one of the following keys:\r\n%s=>>", timer_menu_str);
 }
@@ -330,12 +598,115 @@ static void Print_ADC_Menu(void)
 	smpr_int = adc_smp[index];
 
 	stm32_printf("\r\n[ADC CONFIG]:\r\nSampling time=%d,5 clock cycles\r\n", smpr_int);
+	stm32_printf("Lock-in detection=%s\r\n", LOCKIN_Get_Enable() ? "on" : "off");
+	stm32_printf("Window averaging=%s\r\n", AVG_Get_Enable() ? "on" : "off");
+	stm32_printf("Peak interpolation=%s\r\n", PEAK_Get_Enable() ? "on" : "off");
+	stm32_printf("Harmonic distortion=%s\r\n", THD_Get_Enable() ? "on" : "off");
+	static const char* fft_mode_str[] = {"off", "averaged over the run", "last window"};
+	stm32_printf("Spectrum (FFT)=%s\r\n", fft_mode_str[FFT_Get_Mode()]);
 
 	static const char* timer_menu_str = "s to change ADC sampling time\r\n"
+										"l to toggle lock-in detection (I/Q over whole periods instead of the peak)\r\n"
+										"v to toggle coherent averaging of the windows (turns the spectrum off)\r\n"
+										"p to toggle peak interpolation (crest between the samples instead of the largest one)\r\n"
+										"h to toggle harmonic distortion (THD) measurement\r\n"
+										"f to change the spectrum mode (off, averaged, last window), turns averaging off\r\n"
 										"r to go back to ROOT menu\r\n";
 	stm32_printf("Enter one of the following keys:\r\n%s=>>", timer_menu_str);
 }
 
+static void Print_Stats_Menu(void)
+{
+	static const char* stats_str[] =
+	{
+		[STATS_TIM1_CC_LATENCY] = "TIM1_CC latency",
+		[STATS_TIM15_LATENCY] = "TIM15 latency",
+		[STATS_MAX_SEARCH] = "max search",
+		[STATS_REARM] = "ADC re-arm",
+		[STATS_CAPTURE_TO_ARM] = "capture to armed",
+		[STATS_ARM_SLACK] = "armed to overflow",
+		[STATS_LOCKIN] = "lock-in window",
+		[STATS_AVERAGE] = "average window",
+		[STATS_THD] = "THD window",
+		[STATS_FFT] = "FFT window",
+		[STATS_OUTLIER] = "outlier gate",
+		[STATS_PEAK] = "peak interpolation",
+	};
+	_Static_assert(sizeof(stats_str) / sizeof(stats_str[0]) == STATS_N, "one name per Stats_Id");
+
+	stm32_printf("\r\n[TIMING STATISTICS]: (us, buckets in CPU cycles)\r\n");
+	for (uint32_t i = 0; i < STATS_N; ++i)
+	{
+		const struct Stats_Histogram* h = STATS_Get(i);
+		if (h->count == 0)
+		{
+			stm32_printf("%s: no data\r\n", stats_str[i]);
+			continue;
+		}
+
+		// Cycles to hundredths of us
+		const uint32_t min = (uint64_t) h->min * 100 / (STATS_TIMER_FREQ / 1000000);
+		const uint32_t max = (uint64_t) h->max * 100 / (STATS_TIMER_FREQ / 1000000);
+		stm32_printf("%s: n=%d min=%.2q max=%.2q\r\n ", stats_str[i], h->count, min, max);
+
+		// Non-empty buckets as <upper bound>:count
+		for (uint32_t k = 0; k < STATS_N_BUCKETS; ++k)
+		{
+			if (h->bucket[k] == 0) continue;
+			if (k == STATS_N_BUCKETS - 1) stm32_printf(" >=%d:%d", 1 << k, h->bucket[k]);
+			else stm32_printf(" <%d:%d", 1 << (k + 1), h->bucket[k]);
+		}
+		stm32_printf("\r\n");
+	}
+
+	static const char* stats_menu_str = "c to clear statistics\r\n"
+										"r to go back to ROOT menu\r\n";
+	stm32_printf("Enter one of the following keys:\r\n%s=>>", stats_menu_str);
+}
+
+static void Print_Bode_Menu(void)
+{
+	const uint16_t ref = BODE_Get_Reference();
+
+	// Gain of a run is 20 * log10(AC peak amplitude / reference)
+	stm32_printf("\r\n[BODE CONFIG]:\r\nReference amplitude=%.2q (%s)\r\n", ref, ref == BODE_REF_DEFAULT ? "full-scale sine, dBFS" : "ADC code");
+
+	static const char* bode_menu_str = "a to change reference amplitude\r\n"
+									   "r to go back to ROOT menu\r\n";
+	stm32_printf("Enter one of the following keys:\r\n%s=>>", bode_menu_str);
+}
+
+static void Print_Summary_Menu(void)
+{
+	// Points share their memory with the raw arrays: the mode change clears them
+	stm32_printf("\r\n[SUMMARY]:\r\nSummary mode=%s\r\nPoints stored=%d of %d\r\n",
+			SUM_Get_Enable() ? "on" : "off", SUM_Get_N_Points(), SUM_N_POINTS);
+
+	struct ACQ_Settings settings;
+	ACQ_Get_Settings(&settings);
+	if (settings.tolerance) stm32_printf("Early stop=95 %% confidence within %.2q %%", settings.tolerance);
+	else stm32_printf("Early stop=off");
+	stm32_printf(", periods=%d to %d\r\n", settings.min_periods, settings.n_periods);
+
+	static const char* summary_menu_str = "m to toggle summary mode (clears the points)\r\n"
+										  "t to change early stop tolerance\r\n"
+										  "n / x to change minimum / maximum number of periods\r\n"
+										  "p to print the points\r\n"
+										  "c to clear the points\r\n"
+										  "r to go back to ROOT menu\r\n";
+	stm32_printf("Enter one of the following keys:\r\n%s=>>", summary_menu_str);
+}
+
+static void Print_Summary_Point(const uint32_t i, const struct SUM_Point* p)
+{
+	// Means and standard deviations to hundredths
+	stm32_printf("%d: n=%d psc=%d divide-by=%d smpr=%d flags=%x | TIM1 count mean=%.2q std=%.2q min=%d max=%d"
+			" | ADC max mean=%.2q std=%.2q min=%d max=%d\r\n",
+			i, p->n, p->psc, p->divide_by, p->smpr, p->flags,
+			(p->period_mean * 100) / SUM_MEAN_SCALE, (p->period_std * 100) / SUM_STD_SCALE, p->period_min, p->period_max,
+			(p->amplitude_mean * 100) / SUM_MEAN_SCALE, (p->amplitude_std * 100) / SUM_STD_SCALE, p->amplitude_min, p->amplitude_max);
+}
+
 static uint8_t is_number(const uint8_t ascii)
 {
 	return (0x30 <= ascii) && (ascii <= 0x39);
@@ -376,13 +747,250 @@ static uint8_t Get_Input(uint8_t key, struct Input_Number* in)
 	return done;
 }
 
+static void Print_ACQ_Timeout(void)
+{
+	static const char* stage_str[] = {"", "no signal on PB14 (TIM15 not counting)", "no TIM15 overflow (PB14)", "no capture on PA8"};
+	const uint8_t stage = ACQ_Timeout_Stage();
+	struct ACQ_Settings settings;
+	ACQ_Get_Settings(&settings);
+
+	stm32_printf("\r\n[ERROR]: acquisition timeout, %s after %d of %d periods\r\n",
+			stage <= ACQ_STAGE_CAPTURE ? stage_str[stage] : "", ACQ_Records_Received(), settings.n_periods);
+}
+
+static void Print_Envelope(void)
+{
+	// Lowest safe divide-by per sampling time, and the processing time (busy) per window:
+	// the TIM15 overflow period (divide-by +1 input periods) must stay above busy
+	stm32_printf("\r\n[THROUGHPUT ENVELOPE]: %d periods per point\r\n", ENV_N_PERIODS);
+	stm32_printf("SMPR | sampling | divide-by | min slack (us) | busy (us) | max overflow rate (Hz)\r\n");
+
+	for (uint32_t smpr = 0; smpr < ENV_N_SMPR; ++smpr)
+	{
+		const struct ENV_Result* r = ENV_Get_Result(smpr);
+		if (!r->tested) continue;
+
+		stm32_printf("%d | %d,5 | ", smpr, adc_smp[smpr]);
+		if (!r->safe || r->busy == 0)
+		{
+			stm32_printf(">%d | overrun | - | -\r\n", r->divide_by);
+			continue;
+		}
+
+		// Cycles to hundredths of us
+		const uint32_t slack = (uint64_t) r->slack_min * 100 / (STATS_TIMER_FREQ / 1000000);
+		const uint32_t busy = (uint64_t) r->busy * 100 / (STATS_TIMER_FREQ / 1000000);
+		stm32_printf("%d | %.2q | %.2q | %d\r\n", r->divide_by, slack, busy, STATS_TIMER_FREQ / r->busy);
+	}
+	stm32_printf("Max input frequency = max overflow rate * (divide-by +1)\r\n");
+}
+
+static void Dump_Trace(void)
+{
+#ifdef TRACE_ENABLE
+	// Binary frame, decoded by tools/trace_decode.py
+	stm32_printf("Event trace :\r\n");
+	TRACE_Dump();
+	stm32_printf("\r\n");
+#endif
+}
+
+static void Print_Bode_Row(void)
+{
+	struct ACQ_Settings settings;
+	ACQ_Get_Settings(&settings);
+
+	// Frequency uses the divide-by the run started with: the mean stops at the first
+	// record taken after an automatic raise
+	const struct ACQ_Overrun_Stats* overrun = ACQ_Get_Overrun_Stats();
+	const uint16_t n_periods = (overrun->raised_at < settings.n_periods) ? overrun->raised_at : settings.n_periods;
+	struct BODE_Row row;
+	if (!BODE_Reduce(&row, settings.psc, overrun->divide_by_start, n_periods))
+	{
+		stm32_printf("[BODE]: no period captured\r\n");
+		return;
+	}
+
+	stm32_printf("[BODE]: f=%.2q Hz, ", row.frequency);
+	if (row.amplitude == 0) stm32_printf("gain=-inf dB");
+	else stm32_printf("gain=%.2q dB", row.gain);
+	if (row.lockin) stm32_printf(", phase=%.2q deg", row.phase);
+	if (row.harmonics > 1) stm32_printf(", THD=%.2q %%", row.thd);
+	stm32_printf(" (amplitude=%.2q, reference=%.2q, %d periods)\r\n", row.amplitude, BODE_Get_Reference(), row.n);
+}
+
 static void Print_ACQ_DONE_Info(void)
 {
+	// Runs take the configured number of periods, or less when stopped early
+	struct ACQ_Settings settings;
+	ACQ_Get_Settings(&settings);
+
 	stm32_printf("\r\n[INFO]: Acquisition complete\r\n");
+	if (ACQ_Converged())
+	{
+		// Periods after the stop are left at zero in the arrays
+		stm32_printf("Converged after %d periods\r\n", ACQ_Records_Received());
+	}
+
+	// Absolute time base for the host logs (cycles since boot)
+	const uint64_t start = ACQ_Start_Time();
+	const uint64_t duration = acq_done_time - start;
+	stm32_printf("Started at %d.%06d s after boot, took %d.%06d s\r\n",
+			(uint32_t) (start / TICK_TIME_FREQ), (uint32_t) (start % TICK_TIME_FREQ) / (TICK_TIME_FREQ / 1000000),
+			(uint32_t) (duration / TICK_TIME_FREQ), (uint32_t) (duration % TICK_TIME_FREQ) / (TICK_TIME_FREQ / 1000000));
+	if (RECORD_Dropped())
+	{
+		// Missing periods are left at zero in the arrays
+		stm32_printf("[WARNING]: %d of %d periods dropped (main loop too slow)\r\n", RECORD_Dropped(), settings.n_periods);
+	}
+
+	const struct ACQ_Overrun_Stats* overrun = ACQ_Get_Overrun_Stats();
+	if (overrun->count)
+	{
+		// Skipped periods are not part of the run, it took that many more periods to complete
+		stm32_printf("[WARNING]: %d periods skipped (overrun), first ones before record:", overrun->count);
+		for (uint32_t i = 0; i < overrun->count && i < ACQ_OVERRUN_LOG_SIZE; ++i)
+		{
+			stm32_printf(" %d", overrun->log[i]);
+		}
+		stm32_printf("\r\n");
+		if (overrun->divide_by_end != overrun->divide_by_start)
+		{
+			stm32_printf("[WARNING]: divide-by raised from %d to %d at record %d, later records are left out of the means\r\n",
+					overrun->divide_by_start, overrun->divide_by_end, overrun->raised_at);
+		}
+	}
+
+	struct OUTLIER_Stats outlier;
+	OUTLIER_Get_Stats(&outlier);
+	if (OUTLIER_Get_Enable() && outlier.rejected)
+	{
+		// Rejected captures are left at zero in the arrays, like dropped periods
+		stm32_printf("[WARNING]: %d of %d captures rejected as outliers (median=%d, MAD=%d)\r\n",
+				outlier.rejected, outlier.checked, outlier.median, outlier.mad);
+	}
+
+	struct LOCKIN_Result lockin;
+	if (LOCKIN_Get_Enable() && !LOCKIN_Get_Result(&lockin))
+	{
+		stm32_printf("[WARNING]: lock-in: no window holds a whole signal period (%d rejected), lower SMPR or raise the frequency\r\n", lockin.rejected);
+	}
+	else if (LOCKIN_Get_Enable())
+	{
+		stm32_printf("[LOCK-IN]: %d windows, %d samples integrated, %d rejected\r\n", lockin.windows, lockin.samples, lockin.rejected);
+	}
+
+	struct AVG_Result average;
+	const uint8_t averaged = AVG_Get_Enable() && AVG_Get_Result(&average);
+	if (averaged)
+	{
+		// Noise down by sqrt(windows), the waveform itself is dumped with the arrays
+		stm32_printf("[AVERAGE]: %d windows, max=%.2q min=%.2q amplitude=%.2q\r\n",
+				average.windows, average.max, average.min, (average.max - average.min) / 2);
+	}
+
+	struct PEAK_Result peak;
+	if (PEAK_Get_Enable() && PEAK_Get_Result(&peak))
+	{
+		stm32_printf("[PEAK]: %d windows, %d fitted with the sine model, interpolated amplitude=%.2q\r\n", peak.windows, peak.sine, peak.amplitude);
+	}
+
+	struct THD_Result thd;
+	if (THD_Get_Enable() && !THD_Get_Result(&thd))
+	{
+		stm32_printf("[WARNING]: THD: no fundamental in any window (%d rejected)\r\n", thd.rejected);
+	}
+	else if (THD_Get_Enable())
+	{
+		// Harmonics above fs/2 are left out
+		stm32_printf("[THD]: %d windows, %d rejected, fundamental=%.2q", thd.windows, thd.rejected, thd.amplitude[0]);
+		for (uint32_t h = 1; h < thd.harmonics; ++h)
+		{
+			if (thd.level[h] == INT32_MIN) stm32_printf(", H%d=-inf dBc", h + 1);
+			else stm32_printf(", H%d=%.2q dBc", h + 1, thd.level[h]);
+		}
+		stm32_printf("\r\n");
+	}
+
+	struct FFT_Result fft;
+	const uint8_t spectrum = (FFT_Get_Mode() != FFT_OFF) && FFT_Get_Result(&fft);
+	if (spectrum)
+	{
+		// Bin k is at k * fs / FFT_N, fs = 48 MHz / sample period (ADC clock is 48 MHz / 2)
+		const uint32_t cycles = 2 * adc_smp[ADC1->SMPR & 0x07] + 22;
+		stm32_printf("[FFT]: %d windows, peak=%.2q dBFS at %.2q Hz, spur=%.2q dBc at %.2q Hz, floor=%.2q dBFS/bin\r\n",
+				fft.windows, fft.peak, FIX_Div(FFT_BIN_CENTI_HZ * fft.peak_bin, cycles),
+				fft.spur, FIX_Div(FFT_BIN_CENTI_HZ * fft.spur_bin, cycles), fft.floor);
+	}
+
+	// One line per sweep point, the arrays are only needed for post-processing
+	Print_Bode_Row();
+	if (SUM_Get_Enable())
+	{
+		// No raw arrays in summary mode
+		Print_Summary_Point(SUM_Get_N_Points() - 1, SUM_Get_Last());
+		return;
+	}
+	if (dump_mode == DUMP_BODE) return;
+
+	// Periods of the run only (early stop or abort included), the rest of the arrays is zero padding
+	const uint32_t received = ACQ_Records_Received();
+	const uint32_t n = (received < ACQ_N_PERIODS) ? received : ACQ_N_PERIODS;
+
+	if (dump_mode == DUMP_DMA)
+	{
+		// Frames are queued straight from the result arrays, this returns immediately
+		stm32_printf("Raw TIM1->CNT and ADC->DR data (DMA) :\r\n");
+
+		// Room for every frame before the first header goes out
+		const uint32_t blocks = 3 + averaged + spectrum;
+		if (TRANSPORT_Space() < DUMP_DMA_ENTRIES_PER_BLOCK * blocks)
+		{
+			stm32_printf("[ERROR]: DMA queue full\r\n");
+			return;
+		}
+		if (!DUMP_Raw_DMA_Queue(DUMP_BLOCK_TIMER_CNT, acq_results.timer_cnt, n)
+			|| !DUMP_Raw_DMA_Queue(DUMP_BLOCK_ADC_MAX, acq_results.adc_max_data, n)
+			|| !DUMP_Raw32_DMA_Queue(DUMP_BLOCK_PERIOD_TIME, acq_results.period_time, n)
+			|| (averaged && !DUMP_Raw_DMA_Queue(DUMP_BLOCK_AVERAGE, acq_work.average.data, ADC_ACQ_DATA_SIZE))
+			|| (spectrum && !DUMP_Raw_DMA_Queue(DUMP_BLOCK_SPECTRUM, (const uint16_t*) acq_work.fft.buffer.level, FFT_N_BINS)))
+		{
+			stm32_printf("[ERROR]: DMA queue full\r\n");
+		}
+		return;
+	}
+
+	if (dump_mode == DUMP_COMPRESSED)
+	{
+		const uint32_t text_size = DUMP_Text_Size(acq_results.timer_cnt, n) + DUMP_Text_Size(acq_results.adc_max_data, n)
+			+ DUMP_Text32_Size(acq_results.period_time, n);
+		const uint32_t raw_size = (2 + 2 + 4) * n;
+		uint32_t wire_size = 0;
+
+		stm32_printf("Compressed TIM1->CNT and ADC->DR data :\r\n");
+		wire_size += DUMP_Delta_Varint_Send(DUMP_BLOCK_TIMER_CNT, acq_results.timer_cnt, n);
+		wire_size += DUMP_Delta_Varint_Send(DUMP_BLOCK_ADC_MAX, acq_results.adc_max_data, n);
+		wire_size += DUMP_Delta_Varint32_Send(DUMP_BLOCK_PERIOD_TIME, acq_results.period_time, n);
+		if (averaged)
+		{
+			// Not part of the ratios
+			DUMP_Delta_Varint_Send(DUMP_BLOCK_AVERAGE, acq_work.average.data, ADC_ACQ_DATA_SIZE);
+		}
+		if (spectrum)
+		{
+			DUMP_Delta_Varint_Send(DUMP_BLOCK_SPECTRUM, (const uint16_t*) acq_work.fft.buffer.level, FFT_N_BINS);
+		}
+
+		// Ratios with two decimals (x100)
+		stm32_printf("\r\n%d bytes sent, compression ratio=%.2q vs text, %.2q vs 16-bit binary\r\n",
+				wire_size, (text_size * 100) / wire_size, (raw_size * 100) / wire_size);
+		return;
+	}
+
 	stm32_printf("Raw TIM1->CNT data :\r\n[");
-	for (uint32_t i = 0; i < TIMER_CNT_SIZE; ++i)
+	for (uint32_t i = 0; i < n; ++i)
 	{
-		stm32_printf("%d, ", timer_cnt[i]);
+		stm32_printf("%d, ", acq_results.timer_cnt[i]);
 		if (i+1 % 16 == 0)
 		{
 			stm32_printf("\r\n");
@@ -391,13 +999,41 @@ static void Print_ACQ_DONE_Info(void)
 	stm32_printf("]\r\n");
 
 	stm32_printf("\r\nRaw ADC->DR data :\r\n[");
-	for (uint32_t i = 0; i < ADC_MAX_DATA_SIZE; ++i)
+	for (uint32_t i = 0; i < n; ++i)
 	{
-		stm32_printf("%d, ", adc_max_data[i]);
+		stm32_printf("%d, ", acq_results.adc_max_data[i]);
 		if (i+1 % 16 == 0)
 		{
 			stm32_printf("\r\n");
 		}
 	}
 	stm32_printf("]\r\n");
+
+	stm32_printf("\r\nPeriod time (us since start) :\r\n[");
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		stm32_printf("%d, ", acq_results.period_time[i]);
+	}
+	stm32_printf("]\r\n");
+
+	if (averaged)
+	{
+		stm32_printf("\r\nAveraged window (ADC code) :\r\n[");
+		for (uint32_t i = 0; i < ADC_ACQ_DATA_SIZE; ++i)
+		{
+			// 1/16 code to hundredths
+			stm32_printf("%.2q, ", (acq_work.average.data[i] * 100) / AVG_SCALE);
+		}
+		stm32_printf("]\r\n");
+	}
+
+	if (spectrum)
+	{
+		stm32_printf("\r\nSpectrum (dBFS, bins 0 to fs/2) :\r\n[");
+		for (uint32_t k = 0; k < FFT_N_BINS; ++k)
+		{
+			stm32_printf("%.2q, ", acq_work.fft.buffer.level[k]);
+		}
+		stm32_printf("]\r\n");
+	}
 }
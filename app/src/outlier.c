@@ -0,0 +1,130 @@
+/*
+ * outlier.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "outlier.h"
+#include <stdint.h>
+
+// Gate at 4.5 MAD (3 sigma of gaussian jitter, sigma = 1.48 MAD), in half MAD
+#define OUTLIER_K_HALF_MAD 9
+
+// Plus median / 128: steady captures have a MAD of zero, +-1 count of jitter must pass
+#define OUTLIER_FLOOR_SHIFT 7
+
+// Last captures in arrival order, and the same values sorted
+static uint16_t ring[OUTLIER_WINDOW];
+static uint16_t sorted[OUTLIER_WINDOW];
+static uint8_t head = 0;
+static uint8_t count = 0;
+
+static uint32_t n_checked = 0;
+static uint32_t n_rejected = 0;
+static uint16_t last_median = 0;
+static uint16_t last_mad = 0;
+
+static uint8_t outlier_enable = 1;
+
+void OUTLIER_Reset(void)
+{
+	head = 0;
+	count = 0;
+	n_checked = 0;
+	n_rejected = 0;
+	last_median = 0;
+	last_mad = 0;
+}
+
+static uint16_t OUTLIER_MAD(const uint16_t median)
+{
+	// Median of |x - median|: the deviations grow outwards from the middle of the sorted window,
+	// they are merged like two sorted lists. Each side holds OUTLIER_WINDOW / 2 values, so neither
+	// runs out within the OUTLIER_WINDOW / 2 steps
+	uint32_t l = OUTLIER_WINDOW / 2 - 1;
+	uint32_t r = OUTLIER_WINDOW / 2 + 1;
+	uint16_t d = 0;
+	for (uint32_t k = 0; k < OUTLIER_WINDOW / 2; ++k)
+	{
+		const uint16_t dl = median - sorted[l];
+		const uint16_t dr = sorted[r] - median;
+		if (dl <= dr)
+		{
+			d = dl;
+			--l;
+		}
+		else
+		{
+			d = dr;
+			++r;
+		}
+	}
+	return d;
+}
+
+uint8_t OUTLIER_Check(const uint16_t capture)
+{
+	// Hampel filter, called from the TIM1 capture ISR: the capture is judged against the median
+	// of the previous OUTLIER_WINDOW captures, then replaces the oldest of them (outliers included,
+	// the median ignores them as long as they are fewer than half of the window)
+	// A few hundred cycles whatever the data: O(OUTLIER_WINDOW), no division
+	// Returns 1 if the capture is an outlier, the first OUTLIER_WINDOW captures always pass
+	uint8_t outlier = 0;
+	uint32_t n = count;
+
+	if (count == OUTLIER_WINDOW)
+	{
+		const uint16_t median = sorted[OUTLIER_WINDOW / 2];
+		const uint16_t mad = OUTLIER_MAD(median);
+		const uint32_t d = (capture > median) ? capture - median : median - capture;
+		const uint32_t threshold = ((OUTLIER_K_HALF_MAD * (uint32_t) mad) >> 1) + (median >> OUTLIER_FLOOR_SHIFT) + 1;
+		outlier = (d > threshold);
+		last_median = median;
+		last_mad = mad;
+
+		// Oldest value out of the sorted window
+		const uint16_t old = ring[head];
+		uint32_t i = 0;
+		while (sorted[i] != old) ++i;
+		for (--n; i < n; ++i)
+		{
+			sorted[i] = sorted[i + 1];
+		}
+	}
+	else
+	{
+		++count;
+	}
+
+	// Insertion into the sorted window
+	while (n > 0 && sorted[n - 1] > capture)
+	{
+		sorted[n] = sorted[n - 1];
+		--n;
+	}
+	sorted[n] = capture;
+	ring[head] = capture;
+	head = (head + 1 == OUTLIER_WINDOW) ? 0 : head + 1;
+
+	++n_checked;
+	n_rejected += outlier;
+	return outlier;
+}
+
+void OUTLIER_Get_Stats(struct OUTLIER_Stats* stats)
+{
+	stats->checked = n_checked;
+	stats->rejected = n_rejected;
+	stats->median = last_median;
+	stats->mad = last_mad;
+}
+
+inline void OUTLIER_Set_Enable(const uint8_t enable)
+{
+	outlier_enable = enable;
+}
+
+inline uint8_t OUTLIER_Get_Enable(void)
+{
+	return outlier_enable;
+}
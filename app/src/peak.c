@@ -0,0 +1,130 @@
+/*
+ * peak.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "peak.h"
+#include "fixmath.h"
+#include "adc.h"
+
+// declared in adc.c
+extern uint16_t adc_acq_data[ADC_ACQ_DATA_SIZE];
+
+// Sine model from 16 samples per period up (phase step of 1/16 turn): the parabola is
+// already within 0.05 % there, and the sine model divides by 1 - cos(w) that goes to zero
+#define PEAK_SINE_STEP (1u << 28)
+
+// Sum of the amplitudes (1/16 code) over the windows of the run: 1024 windows fit in 32 bits
+static uint32_t peak_sum = 0;
+static uint32_t peak_windows = 0;
+static uint32_t peak_sine = 0;
+
+static uint8_t peak_enable = 1;
+
+void PEAK_Reset(void)
+{
+	peak_sum = 0;
+	peak_windows = 0;
+	peak_sine = 0;
+}
+
+static uint32_t Peak_Offset(const uint32_t curvature, uint32_t slope, const uint32_t one_minus_cos, const uint32_t sine)
+{
+	// Distance from the extreme sample to the interpolated extreme, in 1/16 of a code, from the
+	// curvature |2b - a - c| and the slope |a - c| of the sample and its two neighbours
+	// one_minus_cos, sine: Q15 of the phase step for the sine model, one_minus_cos = 0 for the parabola
+	if (curvature == 0) return 0;
+
+	if (one_minus_cos != 0)
+	{
+		// Three samples of b - P + A cos(w k + t) around the crest, with w known from the period:
+		// P = A cos(t) = curvature / (2 (1 - cos w)), A sin(t) = slope / (2 sin w), crest = b - P + A
+		// Exact whatever the phase, the errors of P cancel out in A - P near the crest
+		// 1/16 code: curvature * 16 * 2^15 / (2 * Q15), below 2^30 for 10-bit samples
+		uint32_t p = FIX_Div(curvature << 18, one_minus_cos);
+		uint32_t q = FIX_Div(slope << 18, sine);
+		if (p > 0x7FFF) p = 0x7FFF;
+		if (q > 0x7FFF) q = 0x7FFF;
+		return FIX_Sqrt(p * p + q * q) - p;
+	}
+
+	// Parabola through the three samples: crest = b + (a - c)^2 / (8 (2b - a - c)),
+	// the vertex is kept within half a sample of b
+	if (slope > curvature) slope = curvature;
+	return FIX_Div(2 * slope * slope + curvature / 2, curvature);
+}
+
+uint32_t PEAK_Amplitude(const uint16_t* x, const uint32_t n, const uint32_t step)
+{
+	// AC peak amplitude (crest - trough) / 2 of the window in 1/16 of x, the crest and the trough
+	// interpolated around the largest and the smallest sample (the last of equal ones, like
+	// ADC_Find_Max_Value()) from their two neighbours. The extreme samples alone miss the amplitude
+	// by up to A * (1 - cos(w / 2)): 29 % at 4 samples per period
+	// step: signal phase per sample (2^32 = one turn) from LOCKIN_Phase_Step(), 0 if unknown
+	uint32_t hi = 0;
+	uint32_t lo = 0;
+	for (uint32_t k = 1; k < n; ++k)
+	{
+		if (x[k] >= x[hi]) hi = k;
+		if (x[k] <= x[lo]) lo = k;
+	}
+
+	uint32_t one_minus_cos = 0;
+	uint32_t sine = 0;
+	if (step >= PEAK_SINE_STEP)
+	{
+		int32_t co, si;
+		FIX_Sincos(step, &co, &si);
+		one_minus_cos = ((uint32_t) ((1 << 30) - co) >> 15) | 1;
+		sine = ((uint32_t) si >> 15) | 1;
+	}
+
+	// Edge samples stay as they are; 2b - a - c >= 0 at the crest, a + c - 2b >= 0 at the trough
+	uint32_t crest = x[hi] * PEAK_SCALE;
+	if (hi != 0 && hi != n - 1)
+	{
+		const uint32_t a = x[hi - 1];
+		const uint32_t c = x[hi + 1];
+		crest += Peak_Offset(2 * x[hi] - a - c, (a > c) ? a - c : c - a, one_minus_cos, sine);
+	}
+	uint32_t trough = x[lo] * PEAK_SCALE;
+	if (lo != 0 && lo != n - 1)
+	{
+		const uint32_t a = x[lo - 1];
+		const uint32_t c = x[lo + 1];
+		const uint32_t offset = Peak_Offset(a + c - 2 * x[lo], (a > c) ? a - c : c - a, one_minus_cos, sine);
+		trough = (trough > offset) ? trough - offset : 0;
+	}
+
+	return (crest > trough) ? (crest - trough + 1) / 2 : 0;
+}
+
+void PEAK_Window(const uint32_t step)
+{
+	// Called from the bottom half with the window of the period in adc_acq_data
+	peak_sum += PEAK_Amplitude(adc_acq_data, ADC_ACQ_DATA_SIZE, step);
+	peak_sine += (step >= PEAK_SINE_STEP);
+	++peak_windows;
+}
+
+uint8_t PEAK_Get_Result(struct PEAK_Result* result)
+{
+	// Main loop, once the run is over
+	result->windows = peak_windows;
+	result->sine = peak_sine;
+	if (peak_windows == 0) return 0;
+
+	result->amplitude = (uint32_t) (((uint64_t) peak_sum * 100 + peak_windows * PEAK_SCALE / 2) / ((uint64_t) peak_windows * PEAK_SCALE));
+	return 1;
+}
+
+inline void PEAK_Set_Enable(const uint8_t enable)
+{
+	peak_enable = enable;
+}
+
+inline uint8_t PEAK_Get_Enable(void)
+{
+	return peak_enable;
+}
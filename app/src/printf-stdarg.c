@@ -29,6 +29,7 @@
 
 #include <stdarg.h>
 #include "stm32f0xx.h"
+#include "transport.h"
 
 static void printchar(char **str, int c)
 {
@@ -37,8 +38,7 @@ static void printchar(char **str, int c)
 		++(*str);
 	}
 	else {
-		while((USART2->ISR & USART_ISR_TXE) != USART_ISR_TXE);
-		USART2->TDR = (uint16_t) c;
+		TRANSPORT_Send_Byte((unsigned char) c);
 	}
 }
 
@@ -78,11 +78,64 @@ static int prints(char **out, const char *string, int width, int pad)
 /* the following should be enough for 32 bit int */
 #define PRINT_BUF_LEN 12
 
+/*
+ * The Cortex-M0 has no hardware divider: every '/' or '%' on an unsigned int
+ * becomes a call to __aeabi_uidivmod (~40-100 cycles). Base 10 and 16 are
+ * converted without any division, other bases keep the generic loop.
+ */
+
+/* u / 10 with shifts and adds only (q ~= u * 0.8 / 8, then one correction step) */
+static unsigned int divu10(unsigned int u)
+{
+	register unsigned int q;
+
+	q = (u >> 1) + (u >> 2);
+	q += q >> 4;
+	q += q >> 8;
+	q += q >> 16;
+	q >>= 3;
+	if (u - (((q << 2) + q) << 1) > 9)
+		++q;
+	return q;
+}
+
+static char *utoa_rev(char *s, unsigned int u, int b, int letbase)
+{
+	register unsigned int t, q;
+
+	if (b == 10) {
+		while (u) {
+			q = divu10(u);
+			*--s = u - (((q << 2) + q) << 1) + '0';
+			u = q;
+		}
+	}
+	else if (b == 16) {
+		while (u) {
+			t = u & 0x0F;
+			if( t >= 10 )
+				t += letbase - '0' - 10;
+			*--s = t + '0';
+			u >>= 4;
+		}
+	}
+	else {
+		while (u) {
+			t = u % b;
+			if( t >= 10 )
+				t += letbase - '0' - 10;
+			*--s = t + '0';
+			u /= b;
+		}
+	}
+	return s;
+}
+
 static int printi(char **out, int i, int b, int sg, int width, int pad, int letbase)
 {
 	char print_buf[PRINT_BUF_LEN];
 	register char *s;
-	register int t, neg = 0, pc = 0;
+	register int neg = 0, pc = 0;
 	register unsigned int u = i;
 
 	if (i == 0) {
@@ -99,14 +152,56 @@ static int printi(char **out, int i, int b, int sg, int width, int pad, int letb
 	s = print_buf + PRINT_BUF_LEN-1;
 	*s = '\0';
 
-	while (u) {
-		t = u % b;
-		if( t >= 10 )
-			t += letbase - '0' - 10;
-		*--s = t + '0';
-		u /= b;
+	s = utoa_rev(s, u, b, letbase);
+
+	if (neg) {
+		if( width && (pad & PAD_ZERO) ) {
+			printchar (out, '-');
+			++pc;
+			--width;
+		}
+		else {
+			*--s = '-';
+		}
 	}
 
+	return pc + prints (out, s, width, pad);
+}
+
+/* enough for a 32 bit int with up to 9 decimals, sign and point */
+#define PRINTQ_BUF_LEN 24
+
+/*
+ * Fixed-point output: i holds value * 10^prec, it is printed with prec
+ * decimals ("%.2q" with 12345 gives 123.45). No float and no division.
+ */
+static int printq(char **out, int i, int prec, int width, int pad)
+{
+	char print_buf[PRINTQ_BUF_LEN];
+	register char *s;
+	register int neg = 0, pc = 0;
+	register unsigned int u = i, q;
+
+	if (i < 0) {
+		neg = 1;
+		u = -i;
+	}
+
+	s = print_buf + PRINTQ_BUF_LEN-1;
+	*s = '\0';
+
+	if (prec > 0) {
+		for ( ; prec > 0; --prec) {
+			q = divu10(u);
+			*--s = u - (((q << 2) + q) << 1) + '0';
+			u = q;
+		}
+		*--s = '.';
+	}
+
+	if (u == 0) *--s = '0';
+	else s = utoa_rev(s, u, 10, 'a');
+
 	if (neg) {
 		if( width && (pad & PAD_ZERO) ) {
 			printchar (out, '-');
@@ -121,9 +216,13 @@ static int printi(char **out, int i, int b, int sg, int width, int pad, int letb
 	return pc + prints (out, s, width, pad);
 }
 
+/* default number of decimals for %q */
+#define PRINTQ_DEFAULT_PREC 2
+#define PRINTQ_MAX_PREC 9
+
 static int print(char **out, const char *format, va_list args )
 {
-	register int width, pad;
+	register int width, pad, prec;
 	register int pc = 0;
 	char scr[2];
 
@@ -131,6 +230,7 @@ static int print(char **out, const char *format, va_list args )
 		if (*format == '%') {
 			++format;
 			width = pad = 0;
+			prec = -1;
 			if (*format == '\0') break;
 			if (*format == '%') goto out;
 			if (*format == '-') {
@@ -145,6 +245,13 @@ static int print(char **out, const char *format, va_list args )
 				width *= 10;
 				width += *format - '0';
 			}
+			if (*format == '.') {
+				++format;
+				for (prec = 0; *format >= '0' && *format <= '9'; ++format) {
+					prec *= 10;
+					prec += *format - '0';
+				}
+			}
 			if( *format == 's' ) {
 				register char *s = (char *)va_arg( args, int );
 				pc += prints (out, s?s:"(null)", width, pad);
@@ -166,6 +273,12 @@ static int print(char **out, const char *format, va_list args )
 				pc += printi (out, va_arg( args, int ), 10, 0, width, pad, 'a');
 				continue;
 			}
+			if( *format == 'q' ) {
+				if (prec < 0) prec = PRINTQ_DEFAULT_PREC;
+				if (prec > PRINTQ_MAX_PREC) prec = PRINTQ_MAX_PREC;
+				pc += printq (out, va_arg( args, int ), prec, width, pad);
+				continue;
+			}
 			if( *format == 'c' ) {
 				/* char are converted to int then pushed on the stack */
 				scr[0] = (char)va_arg( args, int );
@@ -232,6 +345,7 @@ int main(void)
 	sprintf(buf, "-3: %04d zero padded\n", -3); printf("%s", buf);
 	sprintf(buf, "-3: %-4d left justif.\n", -3); printf("%s", buf);
 	sprintf(buf, "-3: %4d right justif.\n", -3); printf("%s", buf);
+	stm32_sprintf(buf, "fixed: %.2q %.3q %q %06.1q\n", 12345, -5, 7, -25); printf("%s", buf);
 
 	return 0;
 }
@@ -264,6 +378,98 @@ int main(void)
  * -3: -003 zero padded
  * -3: -3   left justif.
  * -3:   -3 right justif.
+ * fixed: 123.45 -0.005 0.07 -002.5
  */
 
 #endif
+
+#ifdef BENCH_PRINTI
+/*
+ * Host benchmark of the integer conversion loop, build from the repository root with
+ *   gcc -O2 -DBENCH_PRINTI -DTRANSPORT_LOOPBACK -DSTM32F072xB -Iapp/inc -Icmsis/core -Icmsis/device/inc \
+ *       app/src/printf-stdarg.c app/src/transport.c
+ * (print() outputs through transport.c, the loopback backend replaces the UART and USB ones)
+ * The host has a hardware divider, so the reference loop goes through
+ * soft_udivmod(), the same shift-subtract algorithm __aeabi_uidivmod runs on
+ * ARMv6-M. Results are host nanoseconds per number, not Cortex-M0 cycles:
+ * only the speedup of the div-free loop is an indication for the target.
+ */
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_N 2000000
+
+static unsigned int soft_udivmod(unsigned int n, unsigned int d, unsigned int *r)
+{
+	unsigned int q = 0, bit = 1;
+
+	while (d < n && !(d & 0x80000000u)) {
+		d <<= 1;
+		bit <<= 1;
+	}
+	while (bit) {
+		if (n >= d) {
+			n -= d;
+			q |= bit;
+		}
+		d >>= 1;
+		bit >>= 1;
+	}
+	*r = n;
+	return q;
+}
+
+static char *utoa_rev_ref(char *s, unsigned int u, unsigned int b)
+{
+	unsigned int t;
+
+	while (u) {
+		u = soft_udivmod(u, b, &t);
+		*--s = (t >= 10) ? t - 10 + 'a' : t + '0';
+	}
+	return s;
+}
+
+static double bench_ns(int ref, int b)
+{
+	struct timespec t0, t1;
+	char buf[PRINT_BUF_LEN];
+	volatile char sink = 0;
+	unsigned int u = 0x9E3779B9u;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (int n = 0; n < BENCH_N; ++n) {
+		u = u * 1664525u + 1013904223u;
+		char *s = ref ? utoa_rev_ref(buf + PRINT_BUF_LEN - 1, u, b)
+		              : utoa_rev(buf + PRINT_BUF_LEN - 1, u, b, 'a');
+		sink ^= *s;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	(void) sink;
+	return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / BENCH_N;
+}
+
+int main(void)
+{
+	char a[PRINT_BUF_LEN], b[PRINT_BUF_LEN], *pa, *pb;
+	unsigned int u = 1, errors = 0;
+
+	/* check against the reference conversion first */
+	for (int n = 0; n < BENCH_N; ++n) {
+		u = u * 1664525u + 1013904223u;
+		a[PRINT_BUF_LEN - 1] = b[PRINT_BUF_LEN - 1] = '\0';
+		pa = utoa_rev(a + PRINT_BUF_LEN - 1, u >> (n & 31), 10, 'a');
+		pb = utoa_rev_ref(b + PRINT_BUF_LEN - 1, u >> (n & 31), 10);
+		while (*pa && *pa == *pb) { ++pa; ++pb; }
+		if (*pa != *pb) ++errors;
+	}
+	printf("base 10 mismatches: %u\n", errors);
+
+	for (int b = 10; b <= 16; b += 6) {
+		const double ref = bench_ns(1, b), div_free = bench_ns(0, b);
+		printf("base %d: %6.1f host ns/number (soft div) %6.1f host ns/number (div-free), speedup %.1fx\n",
+				b, ref, div_free, ref / div_free);
+	}
+	return 0;
+}
+#endif
@@ -0,0 +1,84 @@
+/*
+ * record.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "record.h"
+#include "event.h"
+#include "stm32f0xx.h"
+
+// Single producer (acquisition bottom half) / single consumer (main loop) ring:
+// head is only written by the producer, tail only by the consumer, so no interrupt masking is needed.
+// Indices run freely and are masked on access, head - tail is the number of records available.
+static struct Period_Record ring[RECORD_RING_SIZE];
+static volatile uint32_t head = 0;
+static volatile uint32_t tail = 0;
+
+// Producer side state
+static uint32_t dropped = 0;
+static uint16_t pending_flags = 0;
+
+// Set by the producer when it posts EVT_RECORD, cleared by the consumer before draining:
+// at most one EVT_RECORD is waiting in the event queue
+static volatile uint8_t record_signal = 0;
+
+void RECORD_Reset(void)
+{
+	// Only while the producer is stopped
+	head = 0;
+	tail = 0;
+	dropped = 0;
+	pending_flags = 0;
+	record_signal = 0;
+}
+
+uint8_t RECORD_Push(const struct Period_Record* rec)
+{
+	const uint32_t h = head;
+
+	if (h - tail >= RECORD_RING_SIZE)
+	{
+		// Consumer fell behind: drop this record, never overwrite unread ones
+		++dropped;
+		pending_flags |= RECORD_FLAG_GAP;
+		return 0;
+	}
+
+	ring[h & (RECORD_RING_SIZE - 1)] = *rec;
+	ring[h & (RECORD_RING_SIZE - 1)].flags |= pending_flags;
+	pending_flags = 0;
+
+	// Record content must be visible before the new head
+	__DMB();
+	head = h + 1;
+
+	if (!record_signal)
+	{
+		record_signal = 1;
+		EVENT_Post(EVT_RECORD, 0);
+	}
+	return 1;
+}
+
+uint8_t RECORD_Pop(struct Period_Record* rec)
+{
+	const uint32_t t = tail;
+
+	// Re-arm the signal first: a record pushed while draining posts a new event
+	record_signal = 0;
+
+	if (t == head) return 0;
+
+	*rec = ring[t & (RECORD_RING_SIZE - 1)];
+
+	// Slot must be read before it is given back to the producer
+	__DMB();
+	tail = t + 1;
+	return 1;
+}
+
+inline uint32_t RECORD_Dropped(void)
+{
+	return dropped;
+}
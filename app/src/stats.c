@@ -0,0 +1,82 @@
+/*
+ * stats.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "stats.h"
+#include "stm32f0xx.h"
+
+// Each histogram has a single writer (one ISR or the bottom half)
+static struct Stats_Histogram stats[STATS_N];
+
+void STATS_Init(void)
+{
+	// TIM2 is free-running at 48MHz (configured by TICK_Init())
+	// CH1 captures the counter on TIM15_TRGO (same trigger as the ADC)
+
+	// Select ITR1 (TIM15_TRGO) as trigger input, slave mode stays disabled
+	TIM2->SMCR &= ~TIM_SMCR_TS_Msk;
+	TIM2->SMCR |= (0x01 << TIM_SMCR_TS_Pos);
+
+	// Set CH1 as input, mapped on TRC
+	TIM2->CCMR1 &= ~TIM_CCMR1_CC1S_Msk;
+	TIM2->CCMR1 |= (0x03 << TIM_CCMR1_CC1S_Pos);
+
+	// Enable CH1 capture (no interrupt)
+	TIM2->CCER |= TIM_CCER_CC1E;
+
+	STATS_Clear();
+}
+
+void STATS_Clear(void)
+{
+	__disable_irq();
+	for (uint32_t i = 0; i < STATS_N; ++i)
+	{
+		stats[i].count = 0;
+		stats[i].min = 0xFFFFFFFF;
+		stats[i].max = 0;
+		for (uint32_t k = 0; k < STATS_N_BUCKETS; ++k)
+		{
+			stats[i].bucket[k] = 0;
+		}
+	}
+	__enable_irq();
+}
+
+inline uint32_t STATS_Now(void)
+{
+	return TIM2->CNT;
+}
+
+inline uint32_t STATS_Trigger_Time(void)
+{
+	// TIM2 counter at the last TIM15 overflow
+	return TIM2->CCR1;
+}
+
+void STATS_Add(const uint8_t id, const uint32_t cycles)
+{
+	struct Stats_Histogram* h = &stats[id];
+
+	++h->count;
+	if (cycles < h->min) h->min = cycles;
+	if (cycles > h->max) h->max = cycles;
+
+	// floor(log2(cycles)) without CLZ (not available on Cortex-M0)
+	uint32_t v = cycles;
+	uint32_t k = 0;
+	if (v >= (1 << 16)) { v >>= 16; k += 16; }
+	if (v >= (1 << 8)) { v >>= 8; k += 8; }
+	if (v >= (1 << 4)) { v >>= 4; k += 4; }
+	if (v >= (1 << 2)) { v >>= 2; k += 2; }
+	if (v >= (1 << 1)) { k += 1; }
+
+	++h->bucket[(k < STATS_N_BUCKETS) ? k : STATS_N_BUCKETS - 1];
+}
+
+inline const struct Stats_Histogram* STATS_Get(const uint8_t id)
+{
+	return &stats[id];
+}
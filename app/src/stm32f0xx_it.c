@@ -23,6 +23,13 @@
 #include "stm32f0xx.h"
 #include "timer.h"
 #include "adc.h"
+#include "uart.h"
+#include "usb_cdc.h"
+#include "event.h"
+#include "acq.h"
+#include "tick.h"
+#include "stats.h"
+#include "trace.h"
 
 
 /** @addtogroup STM32F0xx_HAL_Examples
@@ -44,11 +51,8 @@
 /*            Cortex-M0 Processor Exceptions Handlers                         */
 /******************************************************************************/
 
-extern uint8_t current_key;
-extern uint8_t is_new_key;
 extern uint16_t previous_divide_by;
-extern uint8_t adc_acq_data_filled;
-extern uint8_t error_flag;
+extern volatile uint32_t fdiv_overflow_count;
 
 void USART2_IRQHandler(void)
 {
@@ -56,34 +60,68 @@ void USART2_IRQHandler(void)
 	if ((USART2->ISR & USART_ISR_RXNE) == USART_ISR_RXNE)
 	{
 		// Reading data register clears interrupt
-		current_key = (uint8_t) USART2->RDR;
+		const uint8_t key = (uint8_t) USART2->RDR;
 
-		is_new_key = 1;
+		EVENT_Post(EVT_KEY, key);
 
-		// Echo received data
-		while((USART2->ISR & USART_ISR_TXE) != USART_ISR_TXE);
-		USART2->TDR = (uint16_t) current_key;
+		// Echo received data (unless a DMA dump owns the TX line)
+		if (!UART_DMA_Busy())
+		{
+			while((USART2->ISR & USART_ISR_TXE) != USART_ISR_TXE);
+			USART2->TDR = (uint16_t) key;
+		}
+	}
+}
+
+void DMA1_Channel4_5_6_7_IRQHandler(void)
+{
+	// Source is DMA1 channel 4 transfer complete (USART2 TX)
+	if ((DMA1->ISR & DMA_ISR_TCIF4) == DMA_ISR_TCIF4)
+	{
+		// Clears interrupt and starts next queued block
+		UART_DMA_TX_Complete();
+	}
+}
+
+void USB_IRQHandler(void)
+{
+	uint8_t c;
+
+	USB_CDC_IRQ_Process();
+
+	// Keys received from the host are handled like USART2 RX
+	while (USB_CDC_Read_Byte(&c))
+	{
+		EVENT_Post(EVT_KEY, c);
 	}
 }
 
 void TIM1_CC_IRQHandler(void)
 {
+	// Counter at entry, for the latency statistics
+	const uint16_t entry_cnt = TIM1->CNT;
+
 	// Source is TIM1 CC1IF (capture on falling edge on CH1)
 	if ((TIM1->SR & TIM_SR_CC1IF) == TIM_SR_CC1IF)
 	{
-		// Read captured value
-		TIMER_IC_Data_Update(TIM1->CCR1);
+		const uint16_t capture = TIM1->CCR1;
+
+		// TIM1 ticks are PSC+1 cycles
+		STATS_Add(STATS_TIM1_CC_LATENCY, (uint16_t) (entry_cnt - capture) * (TIM1->PSC + 1));
+
+		// Read captured value, window is processed in the bottom half
+		ACQ_Capture(capture);
 
 		// Clear interrupt
 		TIM1->SR &= ~TIM_SR_CC1IF;
-
-		// Set flag for main.c
-		adc_acq_data_filled = 1;
 	}
 }
 
 void TIM15_IRQHandler(void)
 {
+	// TIM2 at entry, for the latency statistics
+	const uint32_t entry_time = STATS_Now();
+
 	// Source is CNT overflow (= update interrupt)
 	// This triggers acquisition of new sample
 	if ((TIM15->SR & TIM_SR_UIF) == TIM_SR_UIF)
@@ -93,23 +131,50 @@ void TIM15_IRQHandler(void)
 
 		// Reload counter
 		TIM15->CNT = (uint16_t) 0xFFFF -previous_divide_by;
+		++fdiv_overflow_count;
+		TRACE(TRACE_TIM15_RELOAD, previous_divide_by);
+
+		// TIM2 captured the overflow (TRGO)
+		const uint32_t trigger_time = STATS_Trigger_Time();
+		STATS_Add(STATS_TIM15_LATENCY, entry_time - trigger_time);
 
-		// Check if CPU managed to handle all previous data, to avoid DMA overwriting
-		if (adc_acq_data_filled == 1)
+		// Check if CPU managed to handle all previous data and re-arm the ADC in time
+		if (ACQ_Trigger_Missed(trigger_time))
 		{
 			// Set LD2 connected on PA5
 			GPIOA->ODR |= GPIO_ODR_5;
 
-			// Disable ADC
-			ADC_ACQ_Disable();
+			// ADC was not re-armed in time: skip this period and keep going
+			ACQ_Overrun();
+		}
+	}
+}
+
+void DMA1_Channel1_IRQHandler(void)
+{
+	// Source is DMA1 channel 1 transfer complete (ADC window full)
+	if ((DMA1->ISR & DMA_ISR_TCIF1) == DMA_ISR_TCIF1)
+	{
+		// Clears interrupt, stops the ADC and calls the window callback
+		ADC_DMA_IRQ_Process();
+	}
+}
 
-			// Disable timers, etc... so that when we go back to the main loop
-			// the CPU still finishes its ADC task but stops and prints error message afterwards
-			TIMER_IC_ACQ_Disable();
-			TIMER_FDIV_Disable();
+void ADC1_COMP_IRQHandler(void)
+{
+	// Source is ADRDY (ADC enabled)
+	ADC_IRQ_Process();
+}
 
-			error_flag = 1;
-		}
+void TIM6_DAC_IRQHandler(void)
+{
+	// Source is TIM6 update: ADC stop or disable request to check again
+	if ((TIM6->SR & TIM_SR_UIF) == TIM_SR_UIF)
+	{
+		// Clear interrupt
+		TIM6->SR &= ~TIM_SR_UIF;
+
+		ADC_Async_Service();
 	}
 }
 
@@ -129,6 +194,12 @@ void NMI_Handler(void)
   */
 void HardFault_Handler(void)
 {
+#ifdef TRACE_ENABLE
+	// Events that led to the fault
+	TRACE(TRACE_FAULT, 0);
+	TRACE_Fault_Dump();
+#endif
+
   /* Go to infinite loop when Hard Fault exception occurs */
   while (1)
   {
@@ -151,6 +222,21 @@ void SVC_Handler(void)
   */
 void PendSV_Handler(void)
 {
+	// Deferred processing of the acquisition (bottom half of TIM1_CC_IRQHandler)
+	ACQ_Bottom_Half();
+}
+
+/**
+  * @brief  This function handles SysTick Handler.
+  * @param  None
+  * @retval None
+  */
+void SysTick_Handler(void)
+{
+	TICK_Process();
+
+	// Acquisition stage timeouts
+	ACQ_Tick();
 }
 
 /******************************************************************************/
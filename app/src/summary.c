@@ -0,0 +1,160 @@
+/*
+ * summary.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "summary.h"
+#include "acq.h"
+#include "record.h"
+#include "fixmath.h"
+
+// Running mean and sum of squared differences (Welford), values * SUM_MEAN_SCALE:
+// updated record by record, no sum of squares that would lose precision or overflow
+struct Welford
+{
+	int32_t mean;
+	uint64_t m2;		// * SUM_MEAN_SCALE
+	uint16_t min;
+	uint16_t max;
+};
+
+static struct Welford period;
+static struct Welford amplitude;
+static uint32_t n = 0;
+static uint8_t flags = 0;
+
+// Last completed run, also kept when the table is full
+static struct SUM_Point last;
+
+static uint32_t n_points = 0;
+static uint8_t sum_enable = 0;
+
+static void Welford_Reset(struct Welford* w)
+{
+	w->mean = 0;
+	w->m2 = 0;
+	w->min = 0xFFFF;
+	w->max = 0;
+}
+
+static void Welford_Add(struct Welford* w, const uint16_t x)
+{
+	// mean += (x - mean) / n, m2 += (x - mean_old) * (x - mean_new)
+	// |delta| < 2^24 for 16-bit values: the division stays in 32 bits (FIX_Div, no divider)
+	const int32_t x_scaled = (int32_t) x * SUM_MEAN_SCALE;
+	const int32_t delta = x_scaled - w->mean;
+	const int32_t step = (int32_t) FIX_Div((uint32_t) (delta < 0 ? -delta : delta) + n / 2, n);
+	w->mean += (delta < 0) ? -step : step;
+	const int32_t delta2 = x_scaled - w->mean;
+
+	w->m2 += (uint64_t) ((int64_t) delta * delta2) / SUM_MEAN_SCALE;
+
+	if (x < w->min) w->min = x;
+	if (x > w->max) w->max = x;
+}
+
+static uint16_t Welford_Std(const struct Welford* w)
+{
+	// Sample standard deviation * SUM_STD_SCALE = sqrt(variance * SUM_MEAN_SCALE)
+	if (n < 2) return 0;
+	const uint64_t variance = w->m2 / (n - 1);
+	if (variance > 0xFFFFFFFF) return 0xFFFF;
+	return FIX_Sqrt((uint32_t) variance);
+}
+
+static uint8_t Welford_Converged(const struct Welford* w, const uint16_t tolerance)
+{
+	// 95 % confidence interval of the mean: 2 * std / sqrt(n) <= mean * tolerance / 10000
+	// std and sqrt(n) both scaled by 16, the interval by SUM_MEAN_SCALE like the mean
+	const uint32_t std = Welford_Std(w);
+	const uint32_t sqrt_n = FIX_Sqrt(n * 256);
+	const uint32_t ci = FIX_Div(2 * std * SUM_MEAN_SCALE, sqrt_n);
+
+	return (uint64_t) ci * 10000 <= (uint64_t) w->mean * tolerance;
+}
+
+uint8_t SUM_Converged(const uint16_t tolerance)
+{
+	// Amplitude and period of the run so far
+	if (n < 2) return 0;
+	return Welford_Converged(&amplitude, tolerance) && Welford_Converged(&period, tolerance);
+}
+
+void SUM_Clear(void)
+{
+	n_points = 0;
+}
+
+void SUM_Begin_Point(void)
+{
+	Welford_Reset(&period);
+	Welford_Reset(&amplitude);
+	n = 0;
+	flags = 0;
+}
+
+void SUM_Add(const uint16_t capture, const uint16_t amp, const uint16_t record_flags)
+{
+	// Main loop (ACQ_Consume()), once per record, outlier captures stay out of the statistics
+	// Captures after a divide-by raise span more input periods: the means stop at the first one
+	flags |= (uint8_t) record_flags;
+	if (record_flags & RECORD_FLAG_OUTLIER) return;
+	if (flags & RECORD_FLAG_DIVIDE_BY_RAISED) return;
+	++n;
+	Welford_Add(&period, capture);
+	Welford_Add(&amplitude, amp);
+}
+
+uint8_t SUM_End_Point(void)
+{
+	// Appends the point of the run that just completed, 0 if the table is full
+	struct ACQ_Settings settings;
+	ACQ_Get_Settings(&settings);
+
+	struct SUM_Point* p = &last;
+	p->period_mean = (n > 0) ? (uint32_t) period.mean : 0;
+	p->amplitude_mean = (n > 0) ? (uint32_t) amplitude.mean : 0;
+	p->period_std = Welford_Std(&period);
+	p->amplitude_std = Welford_Std(&amplitude);
+	p->period_min = (n > 0) ? period.min : 0;
+	p->period_max = period.max;
+	p->amplitude_min = (n > 0) ? amplitude.min : 0;
+	p->amplitude_max = amplitude.max;
+	p->n = (uint16_t) n;
+	p->psc = settings.psc;
+	p->divide_by = ACQ_Get_Overrun_Stats()->divide_by_start;
+	p->smpr = settings.smpr;
+	p->flags = flags;
+
+	if (n_points >= SUM_N_POINTS) return 0;
+	acq_results.points[n_points++] = last;
+	return 1;
+}
+
+inline uint32_t SUM_Get_N_Points(void)
+{
+	return n_points;
+}
+
+inline const struct SUM_Point* SUM_Get_Point(const uint32_t i)
+{
+	return &acq_results.points[i];
+}
+
+inline const struct SUM_Point* SUM_Get_Last(void)
+{
+	return &last;
+}
+
+void SUM_Set_Enable(const uint8_t enable)
+{
+	// The table shares its memory with the raw arrays: it starts empty in both directions
+	sum_enable = enable;
+	n_points = 0;
+}
+
+inline uint8_t SUM_Get_Enable(void)
+{
+	return sum_enable;
+}
@@ -0,0 +1,179 @@
+/*
+ * thd.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "thd.h"
+#include "lockin.h"
+#include "fixmath.h"
+#include "adc.h"
+#include "stm32f0xx.h"
+
+// declared in adc.c
+extern uint16_t adc_acq_data[ADC_ACQ_DATA_SIZE];
+
+// DFT bins of the harmonics, summed over the windows: they start on the same PB14 edge
+// so the bins add up coherently like the lock-in sums
+static int64_t sum_re[THD_N_HARMONICS];
+static int64_t sum_im[THD_N_HARMONICS];
+static uint64_t n_length = 0;		// sum of the integrated lengths, samples in Q16
+static uint32_t n_windows = 0;
+static uint32_t n_rejected = 0;
+static uint8_t n_harmonics = THD_N_HARMONICS;
+
+static uint8_t thd_enable = 0;
+
+void THD_Reset(void)
+{
+	for (uint32_t h = 0; h < THD_N_HARMONICS; ++h)
+	{
+		sum_re[h] = 0;
+		sum_im[h] = 0;
+	}
+	n_length = 0;
+	n_windows = 0;
+	n_rejected = 0;
+	n_harmonics = THD_N_HARMONICS;
+}
+
+static inline void THD_Goertzel(const int32_t c, const int32_t x, int32_t* s1, int32_t* s2)
+{
+	// s0 = x + 2 * cos(w) * s1 - s2, 2 * cos(w) in Q30 on a 64-bit product:
+	// the bins of low frequencies stay apart and the state stays exact
+	const int32_t s0 = x + (int32_t) (((int64_t) c * *s1) >> 29) - *s2;
+	*s2 = *s1;
+	*s1 = s0;
+}
+
+void THD_Window(const uint16_t capture)
+{
+	// Called from the bottom half with the window of the period in adc_acq_data,
+	// capture is the TIM1 count of the same period
+	const uint32_t step = LOCKIN_Phase_Step(capture);
+	const uint32_t n_periods = (uint32_t) (((uint64_t) step * (ADC_ACQ_DATA_SIZE - 1)) >> 32);
+	if (step == 0 || n_periods == 0)
+	{
+		++n_rejected;
+		return;
+	}
+
+	// The last period ends between samples m and m + 1 (at most the last sample) and their mean
+	uint32_t phase = 0;
+	uint32_t turns = 0;
+	uint32_t sum_x = 0;
+	uint32_t m = 0;
+	while (1)
+	{
+		sum_x += adc_acq_data[m];
+		const uint32_t next = phase + step;
+		if (next < phase && ++turns == n_periods) break;
+		phase = next;
+		++m;
+	}
+	const int32_t mean = (int32_t) FIX_Div(sum_x << 4, m + 1);
+
+	// Fraction f of the last sample interval in Q16, both reduced to 16 bits for the division
+	uint32_t r = 0 - phase;
+	uint32_t d = step;
+	while (d >= (1u << 16))
+	{
+		r >>= 1;
+		d >>= 1;
+	}
+	const uint32_t f = FIX_Div(r << 16, d);
+
+	// Trapezoid rule over exactly n_periods, the end is interpolated between samples m and m + 1:
+	// weights 1/2, 1, ..., 1, 1/2 + f - f^2 / 2, f^2 / 2
+	// A sum of whole samples would leak the fundamental into the harmonic bins
+	const uint32_t f2 = (f * f) >> 17;
+	const uint32_t w_m = (1u << 15) + f - f2;
+
+	uint32_t h = 0;
+	for (; h < THD_N_HARMONICS; ++h)
+	{
+		// Harmonics above fs/2 would alias onto lower bins
+		const uint64_t w = (uint64_t) step * (h + 1);
+		if (w >= 0x80000000) break;
+
+		// |s| < 2^14 * 256 / sin(w) stays below 2^31 for one period in 255 samples
+		int32_t c, s;
+		FIX_Sincos((uint32_t) w, &c, &s);
+		int32_t s1 = 0;
+		int32_t s2 = 0;
+		THD_Goertzel(c, (((int32_t) adc_acq_data[0] << 4) - mean) >> 1, &s1, &s2);
+		for (uint32_t k = 1; k < m; ++k)
+		{
+			THD_Goertzel(c, ((int32_t) adc_acq_data[k] << 4) - mean, &s1, &s2);
+		}
+		THD_Goertzel(c, ((((int32_t) adc_acq_data[m] << 4) - mean) * (int32_t) w_m) >> 16, &s1, &s2);
+		THD_Goertzel(c, ((((int32_t) adc_acq_data[m + 1] << 4) - mean) * (int32_t) f2) >> 16, &s1, &s2);
+
+		// Sum of x[k] * e^(-jwk) = e^(-jw(n - 1)) * (s1 - e^(-jw) * s2), n - 1 = m + 1
+		const int32_t y_re = s1 - (int32_t) (((int64_t) c * s2) >> 30);
+		const int32_t y_im = (int32_t) (((int64_t) s * s2) >> 30);
+		int32_t rc, rs;
+		FIX_Sincos(0 - (uint32_t) w * (m + 1), &rc, &rs);
+		sum_re[h] += ((int64_t) y_re * rc - (int64_t) y_im * rs) >> 30;
+		sum_im[h] += ((int64_t) y_re * rs + (int64_t) y_im * rc) >> 30;
+	}
+
+	// Only the harmonics measured in every window are reported
+	if (h < n_harmonics) n_harmonics = (uint8_t) h;
+	n_length += (m << 16) + f;
+	++n_windows;
+}
+
+uint8_t THD_Get_Result(struct THD_Result* result)
+{
+	// Main loop, once the run is over
+	result->windows = n_windows;
+	result->rejected = n_rejected;
+	result->harmonics = n_harmonics;
+	result->thd = 0;
+	if (n_length == 0) return 0;
+
+	// |bin| = A * length / 2, scaled by 16 (mean resolution)
+	uint64_t magnitude[THD_N_HARMONICS];
+	for (uint32_t h = 0; h < n_harmonics; ++h)
+	{
+		// CORDIC inputs must stay below 2^31
+		int64_t re = sum_re[h];
+		int64_t im = sum_im[h];
+		uint32_t s = 0;
+		while (re >= (1LL << 30) || re <= -(1LL << 30) || im >= (1LL << 30) || im <= -(1LL << 30))
+		{
+			re >>= 1;
+			im >>= 1;
+			++s;
+		}
+		magnitude[h] = (uint64_t) FIX_Magnitude((int32_t) re, (int32_t) im) << s;
+		result->amplitude[h] = (uint32_t) ((magnitude[h] * 200) / (n_length >> 12));
+	}
+	if (magnitude[0] == 0) return 0;
+
+	// Harmonic to fundamental ratios in Q15, capped at 1 so that the sum of squares fits in 32 bits
+	uint32_t power = 0;
+	result->level[0] = 0;
+	for (uint32_t h = 1; h < n_harmonics; ++h)
+	{
+		uint64_t r = (magnitude[h] << 15) / magnitude[0];
+		if (r > 32767) r = 32767;
+		power += (uint32_t) (r * r);
+		result->level[h] = (r > 0) ? FIX_dB((uint32_t) r, 32768) : INT32_MIN;
+	}
+
+	// sqrt of a Q30 sum is Q15
+	result->thd = (FIX_Sqrt(power) * 10000 + (1 << 14)) >> 15;
+	return 1;
+}
+
+inline void THD_Set_Enable(const uint8_t enable)
+{
+	thd_enable = enable;
+}
+
+inline uint8_t THD_Get_Enable(void)
+{
+	return thd_enable;
+}
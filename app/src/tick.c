@@ -0,0 +1,85 @@
+/*
+ * tick.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "tick.h"
+#include "stm32f0xx.h"
+
+// Milliseconds since TICK_Init(), wraps after 49 days
+static volatile uint32_t tick_ms = 0;
+
+// TIM2 wraps every 89s: SysTick (every ms) counts the wraps, reads are done with interrupts masked
+static volatile uint32_t time_hi = 0;
+static volatile uint32_t time_last = 0;
+
+void TICK_Init(void)
+{
+	// TIM2 32-bit counter free-running at 48MHz (also used by stats.c)
+
+	// Enable TIM2 clock
+	RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;
+
+	// Reset TIM2 configuration
+	TIM2->CR1 = 0x0000;
+	TIM2->CR2 = 0x0000;
+
+	// Do not divide HCLK, count over the full 32 bits
+	TIM2->PSC = (uint16_t) 0;
+	TIM2->ARR = 0xFFFFFFFF;
+
+	// Load prescaler
+	TIM2->EGR = TIM_EGR_UG;
+
+	// Enable counter
+	TIM2->CR1 |= TIM_CR1_CEN;
+
+	// 1ms SysTick interrupt
+	SysTick_Config(TICK_HCLK_FREQ / TICK_FREQ);
+	NVIC_SetPriority(SysTick_IRQn, TICK_INT_PRIORITY);
+}
+
+void TICK_Process(void)
+{
+	// Called from SysTick_Handler
+	++tick_ms;
+
+	// Higher priority readers must not see a half updated pair
+	__disable_irq();
+	const uint32_t cnt = TIM2->CNT;
+	if (cnt < time_last) ++time_hi;
+	time_last = cnt;
+	__enable_irq();
+}
+
+inline uint32_t TICK_Get_Ms(void)
+{
+	return tick_ms;
+}
+
+uint64_t TICK_Extend(const uint32_t cycles)
+{
+	// 64-bit time of a TIM2 value read (or captured) less than 89s ago, from any priority
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	uint32_t hi = time_hi;
+	const uint32_t last = time_last;
+	const uint32_t now = TIM2->CNT;
+
+	// Wrap since the last SysTick update
+	if (now < last) ++hi;
+
+	// Value taken before that wrap
+	if (cycles > now) --hi;
+
+	__set_PRIMASK(primask);
+	return ((uint64_t) hi << 32) | cycles;
+}
+
+inline uint64_t TICK_Get_Time(void)
+{
+	// Cycles since TICK_Init()
+	return TICK_Extend(TIM2->CNT);
+}
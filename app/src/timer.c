@@ -8,11 +8,11 @@
 #include "timer.h"
 #include "stm32f0xx.h"
 
-// data buffer
-uint16_t timer_cnt[TIMER_CNT_SIZE] = {0};
-
 uint16_t previous_divide_by = 100;
 
+// Incremented by TIM15 overflow ISR (signal presence check)
+volatile uint32_t fdiv_overflow_count = 0;
+
 void TIMER_IC_Init(void)
 {
 	// TIM1 in input capture mode on TI1, connected to PA8
@@ -105,15 +105,6 @@ inline void TIMER_IC_Set_PSC(const uint16_t psc)
 	TIM1->PSC = (uint16_t) psc -1;
 }
 
-void TIMER_IC_Data_Update(const uint16_t new_capture)
-{
-	static uint32_t i = 0;
-
-	// Save current capture in buffer
-	timer_cnt[i++] = new_capture;
-	if(i >= TIMER_CNT_SIZE) i = 0;
-}
-
 void TIMER_FDIV_Init(void)
 {
 	// TIM15 as frequency divider (counter externally clocked)
@@ -0,0 +1,77 @@
+/*
+ * trace.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "trace.h"
+
+#ifdef TRACE_ENABLE
+
+#include "dump.h"
+#include "uart.h"
+#include "transport.h"
+#include "stm32f0xx.h"
+
+static struct Trace_Record trace_ring[TRACE_SIZE];
+
+// Total number of records written since TRACE_Clear()
+static volatile uint32_t trace_count = 0;
+
+// Set while the ring is being dumped
+static volatile uint8_t trace_frozen = 0;
+
+void TRACE_Write(const uint16_t id, const uint16_t arg)
+{
+	// Called from any priority: short critical section (no exclusive access on Cortex-M0)
+	const uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	if (!trace_frozen)
+	{
+		struct Trace_Record* rec = &trace_ring[trace_count & (TRACE_SIZE - 1)];
+		++trace_count;
+		rec->ts = TIM2->CNT;
+		rec->id = id;
+		rec->arg = arg;
+	}
+
+	__set_PRIMASK(primask);
+}
+
+void TRACE_Clear(void)
+{
+	trace_count = 0;
+}
+
+uint32_t TRACE_Dump(void)
+{
+	// Payload: total records written (u32) | records, oldest first
+	trace_frozen = 1;
+
+	const uint32_t n = (trace_count < TRACE_SIZE) ? trace_count : TRACE_SIZE;
+	const uint32_t first = trace_count - n;
+	const uint32_t total = trace_count;
+	const uint32_t payload_size = sizeof(total) + n * sizeof(struct Trace_Record);
+
+	DUMP_Frame_Begin(DUMP_BLOCK_TRACE, DUMP_ENC_TRACE, n, payload_size);
+	uint8_t checksum = DUMP_Frame_Bytes(&total, sizeof(total), 0);
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		checksum = DUMP_Frame_Bytes(&trace_ring[(first + i) & (TRACE_SIZE - 1)], sizeof(struct Trace_Record), checksum);
+	}
+	DUMP_Frame_End(checksum);
+
+	trace_frozen = 0;
+	return DUMP_HEADER_SIZE + payload_size + 1;
+}
+
+void TRACE_Fault_Dump(void)
+{
+	// Called from HardFault_Handler: no interrupt runs anymore, the UART is polled
+	UART_DMA_Abort();
+	TRANSPORT_Select(&transport_uart);
+	TRACE_Dump();
+}
+
+#endif /* TRACE_ENABLE */
@@ -0,0 +1,119 @@
+/*
+ * transport.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "transport.h"
+#include <stdint.h>
+
+#ifndef TRANSPORT_LOOPBACK
+#include "uart.h"
+#include "usb_cdc.h"
+#include "dump.h"
+
+// Header, data and trailer of every frame of a DMA dump, plus the slot a ring keeps empty
+_Static_assert(UART_DMA_QUEUE_SIZE >= DUMP_DMA_QUEUE_ENTRIES + 1, "UART DMA queue too small for a dump");
+_Static_assert(USB_CDC_QUEUE_SIZE >= DUMP_DMA_QUEUE_ENTRIES + 1, "USB CDC queue too small for a dump");
+
+const struct Transport transport_uart =
+{
+	.name = "UART",
+	.send_byte = UART_Send_Byte,
+	.queue = UART_DMA_Queue,
+	.busy = UART_DMA_Busy,
+	.space = UART_DMA_Space,
+};
+
+const struct Transport transport_usb =
+{
+	.name = "USB CDC",
+	.send_byte = USB_CDC_Send_Byte,
+	.queue = USB_CDC_Queue,
+	.busy = USB_CDC_Busy,
+	.space = USB_CDC_Space,
+};
+
+static const struct Transport* transport = &transport_uart;
+
+#else
+
+uint8_t loopback_buf[TRANSPORT_LOOPBACK_SIZE];
+unsigned int loopback_len = 0;
+
+static void Loopback_Send_Byte(const uint8_t c)
+{
+	if (loopback_len < TRANSPORT_LOOPBACK_SIZE)
+	{
+		loopback_buf[loopback_len++] = c;
+	}
+}
+
+static uint8_t Loopback_Queue(const void* data, const uint16_t size)
+{
+	// Copied right away, never busy
+	const uint8_t* bytes = (const uint8_t*) data;
+	if (loopback_len + size > TRANSPORT_LOOPBACK_SIZE) return 0;
+
+	for (uint16_t i = 0; i < size; ++i)
+	{
+		loopback_buf[loopback_len++] = bytes[i];
+	}
+	return 1;
+}
+
+static uint8_t Loopback_Busy(void)
+{
+	return 0;
+}
+
+static uint8_t Loopback_Space(void)
+{
+	// Bounded by loopback_buf only
+	return UINT8_MAX;
+}
+
+const struct Transport transport_loopback =
+{
+	.name = "loopback",
+	.send_byte = Loopback_Send_Byte,
+	.queue = Loopback_Queue,
+	.busy = Loopback_Busy,
+	.space = Loopback_Space,
+};
+
+static const struct Transport* transport = &transport_loopback;
+
+#endif
+
+void TRANSPORT_Select(const struct Transport* new_transport)
+{
+	// Let queued blocks go out on the previous link first
+	while (transport->busy());
+	transport = new_transport;
+}
+
+inline const struct Transport* TRANSPORT_Get(void)
+{
+	return transport;
+}
+
+inline void TRANSPORT_Send_Byte(const uint8_t c)
+{
+	transport->send_byte(c);
+}
+
+inline uint8_t TRANSPORT_Queue(const void* data, const uint16_t size)
+{
+	return transport->queue(data, size);
+}
+
+inline uint8_t TRANSPORT_Busy(void)
+{
+	return transport->busy();
+}
+
+inline uint8_t TRANSPORT_Space(void)
+{
+	return transport->space();
+}
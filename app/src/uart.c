@@ -8,6 +8,20 @@
 #include "uart.h"
 #include "stm32f0xx.h"
 
+struct UART_DMA_Block
+{
+	const uint8_t* data;
+	uint16_t size;
+};
+
+// Blocks waiting for USART2 TX DMA, filled by the main loop and emptied by the DMA ISR
+static struct UART_DMA_Block dma_queue[UART_DMA_QUEUE_SIZE];
+static volatile uint8_t dma_head = 0;
+static volatile uint8_t dma_tail = 0;
+static volatile uint8_t dma_busy = 0;
+
+static void UART_DMA_Start(const struct UART_DMA_Block* block);
+
 void UART_Init(void)
 {
 	/*
@@ -67,3 +81,123 @@ inline void UART_RXINT_Disable(void)
 	// Disable RX interrupt
 	USART2->CR1 &= ~USART_CR1_RXNEIE;
 }
+
+void UART_Send_Byte(const uint8_t c)
+{
+	// Do not interleave with a DMA transfer
+	while(dma_busy);
+
+	// Wait for TX data register to be empty
+	while((USART2->ISR & USART_ISR_TXE) != USART_ISR_TXE);
+	USART2->TDR = (uint16_t) c;
+}
+
+void UART_DMA_Init(void)
+{
+	// USART2_TX is mapped on DMA1 channel 4 (SYSCFG USART2_DMA_RMP = 0)
+	// Memory to peripheral, 8 bits, memory increment, transfer complete interrupt
+
+	// Enable DMA1 clock
+	RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+
+	// Reset configuration
+	DMA1_Channel4->CCR = 0x00000000;
+
+	// Set channel priority to low (ADC uses high priority)
+	DMA1_Channel4->CCR |= (0x00 << DMA_CCR_PL_Pos);
+
+	// Read from memory
+	DMA1_Channel4->CCR |= DMA_CCR_DIR;
+
+	// Enable memory increment mode (8 bits data size is the reset value)
+	DMA1_Channel4->CCR |= DMA_CCR_MINC;
+
+	// Enable transfer complete interrupt
+	DMA1_Channel4->CCR |= DMA_CCR_TCIE;
+
+	// Set peripheral address to USART2->TDR
+	DMA1_Channel4->CPAR = (uint32_t) &USART2->TDR;
+
+	// Enable DMA requests for transmission
+	USART2->CR3 |= USART_CR3_DMAT;
+}
+
+void UART_DMA_NVIC_Init(void)
+{
+	NVIC_SetPriority(DMA1_Channel4_5_6_7_IRQn, UART_DMA_INT_PRIORITY);
+	NVIC_EnableIRQ(DMA1_Channel4_5_6_7_IRQn);
+}
+
+static void UART_DMA_Start(const struct UART_DMA_Block* block)
+{
+	dma_busy = 1;
+
+	DMA1_Channel4->CCR &= ~DMA_CCR_EN;
+	DMA1_Channel4->CMAR = (uint32_t) block->data;
+	DMA1_Channel4->CNDTR = block->size;
+	DMA1_Channel4->CCR |= DMA_CCR_EN;
+}
+
+uint8_t UART_DMA_Queue(const void* data, const uint16_t size)
+{
+	// Memory pointed by data must stay valid until the transfer is done
+	uint8_t queued = 0;
+	const uint8_t next = (dma_head + 1) % UART_DMA_QUEUE_SIZE;
+
+	if (size == 0) return 1;
+
+	NVIC_DisableIRQ(DMA1_Channel4_5_6_7_IRQn);
+	if (next != dma_tail)
+	{
+		dma_queue[dma_head].data = (const uint8_t*) data;
+		dma_queue[dma_head].size = size;
+		dma_head = next;
+		queued = 1;
+
+		// Nothing being sent: start right away
+		if (!dma_busy)
+		{
+			UART_DMA_Start(&dma_queue[dma_tail]);
+		}
+	}
+	NVIC_EnableIRQ(DMA1_Channel4_5_6_7_IRQn);
+
+	return queued;
+}
+
+uint8_t UART_DMA_Space(void)
+{
+	// Free entries of the queue, only grows under the TX complete interrupt
+	return (uint8_t) ((dma_tail + UART_DMA_QUEUE_SIZE - dma_head - 1) % UART_DMA_QUEUE_SIZE);
+}
+
+inline uint8_t UART_DMA_Busy(void)
+{
+	return dma_busy;
+}
+
+void UART_DMA_Abort(void)
+{
+	// Drops the queued blocks, e.g. before printing from a fault handler
+	DMA1_Channel4->CCR &= ~DMA_CCR_EN;
+	DMA1->IFCR = DMA_IFCR_CGIF4;
+	dma_tail = dma_head;
+	dma_busy = 0;
+}
+
+void UART_DMA_TX_Complete(void)
+{
+	// Called from DMA1 channel 4 transfer complete interrupt
+	DMA1->IFCR = DMA_IFCR_CGIF4;
+
+	dma_tail = (dma_tail + 1) % UART_DMA_QUEUE_SIZE;
+	if (dma_tail != dma_head)
+	{
+		UART_DMA_Start(&dma_queue[dma_tail]);
+	}
+	else
+	{
+		DMA1_Channel4->CCR &= ~DMA_CCR_EN;
+		dma_busy = 0;
+	}
+}
@@ -0,0 +1,664 @@
+/*
+ * usb_cdc.c
+ *
+ *  Created on: Oct 18, 2026
+ */
+
+#include "usb_cdc.h"
+#include "stm32f0xx.h"
+
+// USB full-speed device, CDC ACM class (virtual COM port)
+// PA11 (DM) and PA12 (DP) are connected to the transceiver as soon as the peripheral is enabled
+// USB kernel clock is the 48MHz PLL output
+
+// Endpoint registers and packet memory (16 bits access on STM32F0)
+#define USB_EPR(n) (*(__IO uint16_t*) (USB_BASE + 4 * (n)))
+#define USB_PMA(offset) (*(__IO uint16_t*) (USB_PMAADDR + (offset)))
+
+// Buffer description table at the start of the packet memory, 8 bytes per endpoint
+#define BTABLE_ADDR_TX(n) (8 * (n))
+#define BTABLE_COUNT_TX(n) (8 * (n) + 2)
+#define BTABLE_ADDR_RX(n) (8 * (n) + 4)
+#define BTABLE_COUNT_RX(n) (8 * (n) + 6)
+
+// Packet buffers
+#define PMA_EP0_TX 0x40
+#define PMA_EP0_RX 0x80
+#define PMA_EP1_TX 0xC0
+#define PMA_EP2_RX 0x100
+#define PMA_EP3_TX 0x140
+
+// 64 bytes reception buffer: BL_SIZE = 1 (32 bytes blocks), NUM_BLOCK = 1 (2 blocks)
+#define PMA_RX_COUNT_64 0x8400
+
+#define EP_CTRL 0
+#define EP_DATA_IN 1
+#define EP_DATA_OUT 2
+#define EP_NOTIF_IN 3
+#define EP_NOTIF_SIZE 8
+
+// Standard requests
+#define REQ_GET_STATUS 0x00
+#define REQ_CLEAR_FEATURE 0x01
+#define REQ_SET_FEATURE 0x03
+#define REQ_SET_ADDRESS 0x05
+#define REQ_GET_DESCRIPTOR 0x06
+#define REQ_GET_CONFIGURATION 0x08
+#define REQ_SET_CONFIGURATION 0x09
+#define REQ_GET_INTERFACE 0x0A
+#define REQ_SET_INTERFACE 0x0B
+
+// CDC class requests
+#define REQ_SET_LINE_CODING 0x20
+#define REQ_GET_LINE_CODING 0x21
+#define REQ_SET_CONTROL_LINE_STATE 0x22
+#define REQ_SEND_BREAK 0x23
+
+#define REQ_TYPE_MASK 0x60
+#define REQ_TYPE_STANDARD 0x00
+#define REQ_TYPE_CLASS 0x20
+
+struct USB_Setup
+{
+	uint8_t bmRequestType;
+	uint8_t bRequest;
+	uint16_t wValue;
+	uint16_t wIndex;
+	uint16_t wLength;
+};
+
+struct USB_CDC_Block
+{
+	const uint8_t* data;
+	uint16_t size;
+};
+
+static const uint8_t device_desc[] =
+{
+	0x12, 0x01,				// bLength, DEVICE
+	0x00, 0x02,				// USB 2.0
+	0x02, 0x00, 0x00,		// CDC class
+	USB_CDC_PACKET_SIZE,	// EP0 max packet size
+	0x83, 0x04,				// VID 0x0483 (STMicroelectronics)
+	0x40, 0x57,				// PID 0x5740 (virtual COM port)
+	0x00, 0x02,				// bcdDevice
+	0x01, 0x02, 0x00,		// iManufacturer, iProduct, no serial number
+	0x01,					// 1 configuration
+};
+
+static const uint8_t config_desc[] =
+{
+	0x09, 0x02, 67, 0x00,	// bLength, CONFIGURATION, wTotalLength
+	0x02, 0x01, 0x00,		// 2 interfaces, configuration 1, no string
+	0x80, 50,				// bus powered, 100mA
+
+	// Interface 0: communication class, abstract control model
+	0x09, 0x04, 0x00, 0x00, 0x01, 0x02, 0x02, 0x01, 0x00,
+	0x05, 0x24, 0x00, 0x10, 0x01,	// header functional descriptor, CDC 1.10
+	0x05, 0x24, 0x01, 0x00, 0x01,	// call management, data interface 1
+	0x04, 0x24, 0x02, 0x02,			// ACM: line coding and serial state
+	0x05, 0x24, 0x06, 0x00, 0x01,	// union: master 0, slave 1
+	0x07, 0x05, 0x80 | EP_NOTIF_IN, 0x03, EP_NOTIF_SIZE, 0x00, 0xFF,	// notification endpoint, interrupt
+
+	// Interface 1: data class
+	0x09, 0x04, 0x01, 0x00, 0x02, 0x0A, 0x00, 0x00, 0x00,
+	0x07, 0x05, EP_DATA_OUT, 0x02, USB_CDC_PACKET_SIZE, 0x00, 0x00,		// bulk OUT
+	0x07, 0x05, 0x80 | EP_DATA_IN, 0x02, USB_CDC_PACKET_SIZE, 0x00, 0x00,	// bulk IN
+};
+
+static const uint8_t lang_desc[] = {0x04, 0x03, 0x09, 0x04};
+static const char* string_desc[] = {0, "anton", "STM32 Bode table"};
+
+// Line coding is only stored (the link is not a real UART): 9600 bauds, 1 stop bit, no parity, 8 bits
+static uint8_t line_coding[7] = {0x80, 0x25, 0x00, 0x00, 0x00, 0x00, 0x08};
+
+// Control endpoint state
+static uint8_t ep0_buf[USB_CDC_PACKET_SIZE];
+static const uint8_t* ep0_tx_data = 0;
+static uint16_t ep0_tx_remaining = 0;
+static uint8_t ep0_tx_zlp = 0;
+static uint8_t ep0_out_request = 0;
+// Request of the last SETUP was stalled, EP0 stays stalled until the next SETUP
+static uint8_t ep0_stalled = 0;
+static uint8_t pending_address = 0;
+static uint8_t configuration = 0;
+static volatile uint8_t dtr = 0;
+
+// Transmission: staged single bytes, then queued blocks read in place
+static struct USB_CDC_Block tx_queue[USB_CDC_QUEUE_SIZE];
+static volatile uint8_t tx_head = 0;
+static volatile uint8_t tx_tail = 0;
+static const uint8_t* tx_data = 0;
+static volatile uint16_t tx_remaining = 0;
+static uint8_t tx_bytes[USB_CDC_PACKET_SIZE];
+static volatile uint8_t tx_bytes_len = 0;
+static volatile uint8_t tx_busy = 0;
+static uint8_t tx_last_size = 0;
+
+// Reception ring buffer
+static uint8_t rx_buf[USB_CDC_RX_BUFFER_SIZE];
+static volatile uint8_t rx_head = 0;
+static volatile uint8_t rx_tail = 0;
+
+static void PMA_Write(const uint16_t offset, const uint8_t* src, const uint16_t size)
+{
+	for (uint16_t i = 0; i < size; i += 2)
+	{
+		uint16_t half = src[i];
+		if (i + 1 < size) half |= (uint16_t) src[i + 1] << 8;
+		USB_PMA(offset + i) = half;
+	}
+}
+
+static void PMA_Read(const uint16_t offset, uint8_t* dst, const uint16_t size)
+{
+	for (uint16_t i = 0; i < size; i += 2)
+	{
+		const uint16_t half = USB_PMA(offset + i);
+		dst[i] = (uint8_t) half;
+		if (i + 1 < size) dst[i + 1] = (uint8_t) (half >> 8);
+	}
+}
+
+// STAT and DTOG bits toggle when written with 1, CTR bits are cleared when written with 0
+static void EP_Set_Stat_TX(const uint8_t ep, const uint16_t stat)
+{
+	const uint16_t r = USB_EPR(ep);
+	USB_EPR(ep) = ((r & (USB_EPREG_MASK | USB_EPTX_STAT)) ^ stat) | USB_EP_CTR_RX | USB_EP_CTR_TX;
+}
+
+static void EP_Set_Stat_RX(const uint8_t ep, const uint16_t stat)
+{
+	const uint16_t r = USB_EPR(ep);
+	USB_EPR(ep) = ((r & (USB_EPREG_MASK | USB_EPRX_STAT)) ^ stat) | USB_EP_CTR_RX | USB_EP_CTR_TX;
+}
+
+static void EP_Init(const uint8_t ep, const uint16_t type)
+{
+	// Writing the current toggle bits back clears them: DTOG = 0, both directions disabled
+	const uint16_t r = USB_EPR(ep);
+	USB_EPR(ep) = type | ep | (r & (USB_EP_DTOG_RX | USB_EPRX_STAT | USB_EP_DTOG_TX | USB_EPTX_STAT));
+}
+
+static void TX_Flush(void)
+{
+	tx_head = tx_tail;
+	tx_remaining = 0;
+	tx_bytes_len = 0;
+	tx_busy = 0;
+	tx_last_size = 0;
+}
+
+static void TX_Next_Packet(void)
+{
+	// Must run with USB interrupt masked or from USB interrupt
+	uint16_t size;
+
+	if (tx_remaining == 0 && tx_bytes_len == 0 && tx_tail != tx_head)
+	{
+		tx_data = tx_queue[tx_tail].data;
+		tx_remaining = tx_queue[tx_tail].size;
+		tx_tail = (tx_tail + 1) % USB_CDC_QUEUE_SIZE;
+	}
+
+	if (tx_remaining > 0)
+	{
+		size = (tx_remaining > USB_CDC_PACKET_SIZE) ? USB_CDC_PACKET_SIZE : tx_remaining;
+		PMA_Write(PMA_EP1_TX, tx_data, size);
+		tx_data += size;
+		tx_remaining -= size;
+	}
+	else if (tx_bytes_len > 0)
+	{
+		size = tx_bytes_len;
+		PMA_Write(PMA_EP1_TX, tx_bytes, size);
+		tx_bytes_len = 0;
+	}
+	else if (tx_last_size == USB_CDC_PACKET_SIZE)
+	{
+		// Zero length packet ends a transfer made of full packets
+		size = 0;
+	}
+	else
+	{
+		tx_busy = 0;
+		return;
+	}
+
+	USB_PMA(BTABLE_COUNT_TX(EP_DATA_IN)) = size;
+	tx_last_size = (uint8_t) size;
+	tx_busy = 1;
+	EP_Set_Stat_TX(EP_DATA_IN, USB_EP_TX_VALID);
+}
+
+static void EP0_Send_Next(void)
+{
+	const uint16_t size = (ep0_tx_remaining > USB_CDC_PACKET_SIZE) ? USB_CDC_PACKET_SIZE : ep0_tx_remaining;
+
+	PMA_Write(PMA_EP0_TX, ep0_tx_data, size);
+	USB_PMA(BTABLE_COUNT_TX(EP_CTRL)) = size;
+	ep0_tx_data += size;
+	ep0_tx_remaining -= size;
+	EP_Set_Stat_TX(EP_CTRL, USB_EP_TX_VALID);
+}
+
+static void EP0_Send(const uint8_t* data, uint16_t size, const uint16_t max_size)
+{
+	if (size > max_size) size = max_size;
+
+	// A data stage shorter than requested and made of full packets ends with a zero length packet
+	ep0_tx_zlp = (size > 0) && (size < max_size) && ((size % USB_CDC_PACKET_SIZE) == 0);
+	ep0_tx_data = data;
+	ep0_tx_remaining = size;
+	EP0_Send_Next();
+}
+
+static void EP0_Stall(void)
+{
+	ep0_stalled = 1;
+	EP_Set_Stat_TX(EP_CTRL, USB_EP_TX_STALL);
+	EP_Set_Stat_RX(EP_CTRL, USB_EP_RX_STALL);
+}
+
+static uint16_t String_Descriptor(const char* str)
+{
+	// ASCII to UTF-16LE
+	uint16_t size = 2;
+	for ( ; *str && size < USB_CDC_PACKET_SIZE; ++str)
+	{
+		ep0_buf[size++] = (uint8_t) *str;
+		ep0_buf[size++] = 0;
+	}
+	ep0_buf[0] = (uint8_t) size;
+	ep0_buf[1] = 0x03;
+	return size;
+}
+
+static void Configure_Data_Endpoints(void)
+{
+	EP_Init(EP_DATA_IN, USB_EP_BULK);
+	EP_Set_Stat_TX(EP_DATA_IN, USB_EP_TX_NAK);
+
+	EP_Init(EP_DATA_OUT, USB_EP_BULK);
+	EP_Set_Stat_RX(EP_DATA_OUT, USB_EP_RX_VALID);
+
+	EP_Init(EP_NOTIF_IN, USB_EP_INTERRUPT);
+	EP_Set_Stat_TX(EP_NOTIF_IN, USB_EP_TX_NAK);
+
+	TX_Flush();
+}
+
+static void EP0_Standard_Request(const struct USB_Setup* setup)
+{
+	switch (setup->bRequest)
+	{
+	case REQ_GET_STATUS:
+		ep0_buf[0] = 0;
+		ep0_buf[1] = 0;
+		EP0_Send(ep0_buf, 2, setup->wLength);
+		break;
+	case REQ_CLEAR_FEATURE:
+	case REQ_SET_FEATURE:
+	case REQ_SET_INTERFACE:
+		EP0_Send(0, 0, 0);
+		break;
+	case REQ_SET_ADDRESS:
+		// Address is applied once the status stage is complete
+		pending_address = setup->wValue & 0x7F;
+		EP0_Send(0, 0, 0);
+		break;
+	case REQ_GET_DESCRIPTOR:
+		switch (setup->wValue >> 8)
+		{
+		case 0x01:
+			EP0_Send(device_desc, sizeof(device_desc), setup->wLength);
+			break;
+		case 0x02:
+			EP0_Send(config_desc, sizeof(config_desc), setup->wLength);
+			break;
+		case 0x03:
+			if ((setup->wValue & 0xFF) == 0)
+			{
+				EP0_Send(lang_desc, sizeof(lang_desc), setup->wLength);
+			}
+			else if ((setup->wValue & 0xFF) < sizeof(string_desc) / sizeof(string_desc[0]))
+			{
+				EP0_Send(ep0_buf, String_Descriptor(string_desc[setup->wValue & 0xFF]), setup->wLength);
+			}
+			else
+			{
+				EP0_Stall();
+			}
+			break;
+		default:
+			EP0_Stall();
+			break;
+		}
+		break;
+	case REQ_GET_CONFIGURATION:
+		ep0_buf[0] = configuration;
+		EP0_Send(ep0_buf, 1, setup->wLength);
+		break;
+	case REQ_SET_CONFIGURATION:
+		configuration = setup->wValue & 0xFF;
+		if (configuration) Configure_Data_Endpoints();
+		EP0_Send(0, 0, 0);
+		break;
+	case REQ_GET_INTERFACE:
+		ep0_buf[0] = 0;
+		EP0_Send(ep0_buf, 1, setup->wLength);
+		break;
+	default:
+		EP0_Stall();
+		break;
+	}
+}
+
+static void EP0_Class_Request(const struct USB_Setup* setup)
+{
+	switch (setup->bRequest)
+	{
+	case REQ_SET_LINE_CODING:
+		// Wait for the data stage
+		ep0_out_request = REQ_SET_LINE_CODING;
+		break;
+	case REQ_GET_LINE_CODING:
+		EP0_Send(line_coding, sizeof(line_coding), setup->wLength);
+		break;
+	case REQ_SET_CONTROL_LINE_STATE:
+		// DTR is set while a terminal has the port open
+		dtr = setup->wValue & 0x01;
+		if (!dtr) TX_Flush();
+		EP0_Send(0, 0, 0);
+		break;
+	case REQ_SEND_BREAK:
+		EP0_Send(0, 0, 0);
+		break;
+	default:
+		EP0_Stall();
+		break;
+	}
+}
+
+static void EP0_Setup(void)
+{
+	struct USB_Setup setup;
+	uint8_t raw[8];
+
+	PMA_Read(PMA_EP0_RX, raw, 8);
+	setup.bmRequestType = raw[0];
+	setup.bRequest = raw[1];
+	setup.wValue = raw[2] | (raw[3] << 8);
+	setup.wIndex = raw[4] | (raw[5] << 8);
+	setup.wLength = raw[6] | (raw[7] << 8);
+
+	ep0_out_request = 0;
+	ep0_tx_remaining = 0;
+	ep0_tx_zlp = 0;
+	ep0_stalled = 0;
+
+	if ((setup.bmRequestType & REQ_TYPE_MASK) == REQ_TYPE_STANDARD)
+	{
+		EP0_Standard_Request(&setup);
+	}
+	else if ((setup.bmRequestType & REQ_TYPE_MASK) == REQ_TYPE_CLASS)
+	{
+		EP0_Class_Request(&setup);
+	}
+	else
+	{
+		EP0_Stall();
+	}
+}
+
+static void USB_Reset(void)
+{
+	USB->BTABLE = 0;
+
+	USB_PMA(BTABLE_ADDR_TX(EP_CTRL)) = PMA_EP0_TX;
+	USB_PMA(BTABLE_COUNT_TX(EP_CTRL)) = 0;
+	USB_PMA(BTABLE_ADDR_RX(EP_CTRL)) = PMA_EP0_RX;
+	USB_PMA(BTABLE_COUNT_RX(EP_CTRL)) = PMA_RX_COUNT_64;
+
+	USB_PMA(BTABLE_ADDR_TX(EP_DATA_IN)) = PMA_EP1_TX;
+	USB_PMA(BTABLE_COUNT_TX(EP_DATA_IN)) = 0;
+
+	USB_PMA(BTABLE_ADDR_RX(EP_DATA_OUT)) = PMA_EP2_RX;
+	USB_PMA(BTABLE_COUNT_RX(EP_DATA_OUT)) = PMA_RX_COUNT_64;
+
+	USB_PMA(BTABLE_ADDR_TX(EP_NOTIF_IN)) = PMA_EP3_TX;
+	USB_PMA(BTABLE_COUNT_TX(EP_NOTIF_IN)) = 0;
+
+	EP_Init(EP_CTRL, USB_EP_CONTROL);
+	EP_Set_Stat_RX(EP_CTRL, USB_EP_RX_VALID);
+	EP_Set_Stat_TX(EP_CTRL, USB_EP_TX_NAK);
+
+	// Default address 0
+	USB->DADDR = USB_DADDR_EF;
+
+	configuration = 0;
+	pending_address = 0;
+	dtr = 0;
+	TX_Flush();
+}
+
+static void EP0_Process(const uint16_t epr)
+{
+	if (epr & USB_EP_CTR_RX)
+	{
+		USB_EPR(EP_CTRL) = (epr & USB_EPREG_MASK & ~USB_EP_CTR_RX) | USB_EP_CTR_TX;
+
+		if (epr & USB_EP_SETUP)
+		{
+			EP0_Setup();
+
+			// RX VALID would cancel the STALL, a pending CTR_TX interrupt comes back
+			if (ep0_stalled) return;
+		}
+		else if (ep0_out_request == REQ_SET_LINE_CODING)
+		{
+			// Data stage of SET_LINE_CODING, acknowledged with a zero length packet
+			PMA_Read(PMA_EP0_RX, line_coding, sizeof(line_coding));
+			ep0_out_request = 0;
+			EP0_Send(0, 0, 0);
+		}
+		// else: status stage of an IN transfer
+
+		EP_Set_Stat_RX(EP_CTRL, USB_EP_RX_VALID);
+	}
+
+	if (epr & USB_EP_CTR_TX)
+	{
+		USB_EPR(EP_CTRL) = (epr & USB_EPREG_MASK & ~USB_EP_CTR_TX) | USB_EP_CTR_RX;
+
+		if (pending_address)
+		{
+			USB->DADDR = USB_DADDR_EF | pending_address;
+			pending_address = 0;
+		}
+
+		if (ep0_tx_remaining > 0)
+		{
+			EP0_Send_Next();
+		}
+		else if (ep0_tx_zlp)
+		{
+			ep0_tx_zlp = 0;
+			EP0_Send_Next();
+		}
+	}
+}
+
+static void EP_Data_Process(const uint8_t ep, const uint16_t epr)
+{
+	if (epr & USB_EP_CTR_RX)
+	{
+		USB_EPR(ep) = (epr & USB_EPREG_MASK & ~USB_EP_CTR_RX) | USB_EP_CTR_TX;
+
+		if (ep == EP_DATA_OUT)
+		{
+			uint8_t packet[USB_CDC_PACKET_SIZE];
+			const uint16_t count = USB_PMA(BTABLE_COUNT_RX(EP_DATA_OUT)) & 0x03FF;
+
+			PMA_Read(PMA_EP2_RX, packet, count);
+			for (uint16_t i = 0; i < count; ++i)
+			{
+				const uint8_t next = (rx_head + 1) % USB_CDC_RX_BUFFER_SIZE;
+				// Drop bytes when the application does not read them
+				if (next == rx_tail) break;
+				rx_buf[rx_head] = packet[i];
+				rx_head = next;
+			}
+			EP_Set_Stat_RX(EP_DATA_OUT, USB_EP_RX_VALID);
+		}
+	}
+
+	if (epr & USB_EP_CTR_TX)
+	{
+		USB_EPR(ep) = (epr & USB_EPREG_MASK & ~USB_EP_CTR_TX) | USB_EP_CTR_RX;
+
+		if (ep == EP_DATA_IN)
+		{
+			TX_Next_Packet();
+		}
+	}
+}
+
+void USB_CDC_Init(void)
+{
+	// Select PLL (48MHz) as USB clock
+	RCC->CFGR3 |= RCC_CFGR3_USBSW_PLLCLK;
+
+	// Enable USB clock
+	RCC->APB1ENR |= RCC_APB1ENR_USBEN;
+
+	// Exit power down and keep the peripheral in reset for tSTARTUP (1us)
+	USB->CNTR = USB_CNTR_FRES;
+	for (volatile uint32_t i = 0; i < 100; ++i);
+
+	// Release reset and clear pending interrupts
+	USB->CNTR = 0;
+	USB->ISTR = 0;
+
+	// Enable correct transfer, reset and start of frame interrupts
+	USB->CNTR = USB_CNTR_CTRM | USB_CNTR_RESETM | USB_CNTR_SOFM;
+
+	// Enable DP pull-up: the host sees the device
+	USB->BCDR |= USB_BCDR_DPPU;
+}
+
+void USB_CDC_NVIC_Init(void)
+{
+	NVIC_SetPriority(USB_IRQn, USB_INT_PRIORITY);
+	NVIC_EnableIRQ(USB_IRQn);
+}
+
+void USB_CDC_IRQ_Process(void)
+{
+	uint16_t istr;
+
+	if (USB->ISTR & USB_ISTR_RESET)
+	{
+		USB->ISTR = (uint16_t) ~USB_ISTR_RESET;
+		USB_Reset();
+	}
+
+	while ((istr = USB->ISTR) & USB_ISTR_CTR)
+	{
+		const uint8_t ep = istr & USB_ISTR_EP_ID;
+		const uint16_t epr = USB_EPR(ep);
+
+		if (ep == EP_CTRL) EP0_Process(epr);
+		else EP_Data_Process(ep, epr);
+	}
+
+	if (USB->ISTR & USB_ISTR_SOF)
+	{
+		USB->ISTR = (uint16_t) ~USB_ISTR_SOF;
+
+		// Every 1ms: send bytes staged by USB_CDC_Send_Byte()
+		if (!tx_busy && tx_bytes_len > 0)
+		{
+			TX_Next_Packet();
+		}
+	}
+
+	// Other events are not used
+	USB->ISTR = (uint16_t) ~(USB_ISTR_PMAOVR | USB_ISTR_ERR | USB_ISTR_WKUP | USB_ISTR_SUSP | USB_ISTR_ESOF | USB_ISTR_L1REQ);
+}
+
+inline uint8_t USB_CDC_Connected(void)
+{
+	return configuration && dtr;
+}
+
+uint8_t USB_CDC_Busy(void)
+{
+	// Queued blocks are not sent yet
+	return USB_CDC_Connected() && ((tx_head != tx_tail) || tx_remaining > 0);
+}
+
+void USB_CDC_Send_Byte(const uint8_t c)
+{
+	// Nobody listening: drop data instead of blocking
+	if (!USB_CDC_Connected()) return;
+
+	// Keep ordering with queued blocks, then wait for room in the staging packet
+	while (USB_CDC_Busy());
+	while (USB_CDC_Connected() && tx_bytes_len >= USB_CDC_PACKET_SIZE);
+
+	NVIC_DisableIRQ(USB_IRQn);
+	if (tx_bytes_len < USB_CDC_PACKET_SIZE)
+	{
+		tx_bytes[tx_bytes_len++] = c;
+
+		// Full packet: no need to wait for next SOF
+		if (tx_bytes_len == USB_CDC_PACKET_SIZE && !tx_busy)
+		{
+			TX_Next_Packet();
+		}
+	}
+	NVIC_EnableIRQ(USB_IRQn);
+}
+
+uint8_t USB_CDC_Queue(const void* data, const uint16_t size)
+{
+	// Memory pointed by data must stay valid until the transfer is done
+	uint8_t queued = 0;
+	const uint8_t next = (tx_head + 1) % USB_CDC_QUEUE_SIZE;
+
+	if (!USB_CDC_Connected()) return 0;
+	if (size == 0) return 1;
+
+	NVIC_DisableIRQ(USB_IRQn);
+	if (next != tx_tail)
+	{
+		tx_queue[tx_head].data = (const uint8_t*) data;
+		tx_queue[tx_head].size = size;
+		tx_head = next;
+		queued = 1;
+
+		if (!tx_busy)
+		{
+			TX_Next_Packet();
+		}
+	}
+	NVIC_EnableIRQ(USB_IRQn);
+
+	return queued;
+}
+
+uint8_t USB_CDC_Space(void)
+{
+	// Free entries of the queue, only grows under the USB interrupt
+	return (uint8_t) ((tx_tail + USB_CDC_QUEUE_SIZE - tx_head - 1) % USB_CDC_QUEUE_SIZE);
+}
+
+uint8_t USB_CDC_Read_Byte(uint8_t* c)
+{
+	if (rx_tail == rx_head) return 0;
+
+	*c = rx_buf[rx_tail];
+	rx_tail = (rx_tail + 1) % USB_CDC_RX_BUFFER_SIZE;
+	return 1;
+}
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+"""
+dump_decode.py
+
+Decodes the binary dump frames (compressed or raw DMA) sent by the firmware (see app/inc/dump.h)
+from a raw capture of the serial link, e.g.:
+
+    stty -F /dev/ttyACM0 9600 raw && cat /dev/ttyACM0 > capture.bin
+    python3 tools/dump_decode.py capture.bin
+
+Text printed by the firmware around the frames is ignored.
+"""
+
+import argparse
+import struct
+import sys
+
+DUMP_MAGIC = b"\xA5\x5A"
+DUMP_HEADER = struct.Struct("<2sBBHH")
+
+BLOCK_NAMES = {
+    0x01: "timer_cnt",
+    0x02: "adc_max_data",
+    0x04: "period_time_us",
+    0x05: "average_x16",
+    0x06: "spectrum_dbfs_x100",
+}
+
+# Blocks of int16 values (sent as 16-bit words)
+SIGNED_BLOCKS = {0x06}
+
+ENC_RAW16 = 0x00
+ENC_DELTA_VARINT = 0x01
+ENC_RAW32 = 0x03
+ENC_DELTA_VARINT32 = 0x04
+
+
+def decode_raw16(payload, count):
+    if len(payload) != 2 * count:
+        raise ValueError("payload length mismatch")
+    return list(struct.unpack("<%dH" % count, payload))
+
+
+def decode_raw32(payload, count):
+    if len(payload) != 4 * count:
+        raise ValueError("payload length mismatch")
+    return list(struct.unpack("<%dI" % count, payload))
+
+
+def decode_delta_varint(payload, count, mask=0xFFFF):
+    values = []
+    previous = 0
+    pos = 0
+    for _ in range(count):
+        v = 0
+        shift = 0
+        while True:
+            byte = payload[pos]
+            pos += 1
+            v |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                break
+        delta = (v >> 1) ^ -(v & 1)
+        previous = (previous + delta) & mask
+        values.append(previous)
+    if pos != len(payload):
+        raise ValueError("payload length mismatch")
+    return values
+
+
+DECODERS = {
+    ENC_RAW16: decode_raw16,
+    ENC_DELTA_VARINT: decode_delta_varint,
+    ENC_RAW32: decode_raw32,
+    ENC_DELTA_VARINT32: lambda payload, count: decode_delta_varint(payload, count, 0xFFFFFFFF),
+}
+
+
+def check_tail(data, end, block_id, encoding, payload):
+    """Returns the tail size if the checksum (or the raw DMA trailer) is valid, 0 otherwise."""
+    if encoding in (ENC_RAW16, ENC_RAW32):
+        trailer = DUMP_MAGIC[::-1] + bytes([block_id])
+        return len(trailer) if data[end:end + len(trailer)] == trailer else 0
+    if end < len(data) and (sum(payload) & 0xFF) == data[end]:
+        return 1
+    return 0
+
+
+def iter_frames(data):
+    """Yields (block_id, values, wire_size) for every valid frame in data."""
+    pos = data.find(DUMP_MAGIC)
+    while pos >= 0 and pos + DUMP_HEADER.size <= len(data):
+        _, block_id, encoding, count, length = DUMP_HEADER.unpack_from(data, pos)
+        start = pos + DUMP_HEADER.size
+        end = start + length
+        if end > len(data) or encoding not in DECODERS:
+            pos = data.find(DUMP_MAGIC, pos + 1)
+            continue
+        payload = data[start:end]
+        tail = check_tail(data, end, block_id, encoding, payload)
+        if not tail:
+            print("warning: bad checksum or trailer at offset %d" % pos, file=sys.stderr)
+            pos = data.find(DUMP_MAGIC, pos + 1)
+            continue
+        yield block_id, DECODERS[encoding](payload, count), end + tail - pos
+        pos = data.find(DUMP_MAGIC, end + tail)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", nargs="?", help="raw serial capture (default: stdin)")
+    parser.add_argument("--csv", action="store_true", help="print blocks as CSV columns")
+    args = parser.parse_args()
+
+    data = open(args.capture, "rb").read() if args.capture else sys.stdin.buffer.read()
+
+    blocks = []
+    for block_id, values, wire_size in iter_frames(data):
+        name = BLOCK_NAMES.get(block_id, "block_0x%02x" % block_id)
+        if block_id in SIGNED_BLOCKS:
+            values = [v - 0x10000 if v >= 0x8000 else v for v in values]
+        text_size = sum(len("%d, " % v) for v in values)
+        print("%s: %d values, %d bytes on the wire, ratio %.2f vs text, %.2f vs 16-bit binary"
+              % (name, len(values), wire_size, text_size / wire_size, 2 * len(values) / wire_size),
+              file=sys.stderr)
+        blocks.append((name, values))
+
+    if args.csv:
+        print(",".join(name for name, _ in blocks))
+        for row in zip(*(values for _, values in blocks)):
+            print(",".join(str(v) for v in row))
+    else:
+        for name, values in blocks:
+            print("%s = %s" % (name, values))
+
+
+if __name__ == "__main__":
+    main()
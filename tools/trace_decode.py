@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""
+trace_decode.py
+
+Turns the event trace frames (firmware built with -DTRACE_ENABLE, see app/inc/trace.h)
+found in a raw capture of the serial link into a timeline, e.g.:
+
+    stty -F /dev/ttyACM0 9600 raw && cat /dev/ttyACM0 > capture.bin
+    python3 tools/trace_decode.py capture.bin
+
+Event names are read from the Trace_Id and Event_Id enums of the firmware headers.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+from dump_decode import DUMP_HEADER, DUMP_MAGIC
+
+BLOCK_TRACE = 0x03
+ENC_TRACE = 0x02
+
+TRACE_RECORD = struct.Struct("<IHH")
+TIMER_FREQ = 48e6
+
+INC_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "app", "inc")
+
+# Records whose arg is "event id << 8 | event arg"
+EVENT_TRACES = ("TRACE_EVENT_POST", "TRACE_EVENT_GET")
+
+
+def read_enum(path, enum_name):
+    """Returns {value: name} for a C enum with implicit or explicit values."""
+    try:
+        text = open(path).read()
+    except OSError:
+        return {}
+    m = re.search(r"enum\s+%s\s*\{(.*?)\}" % enum_name, text, re.S)
+    if not m:
+        return {}
+    names = {}
+    value = -1
+    for line in m.group(1).splitlines():
+        line = line.split("//")[0].strip().rstrip(",")
+        if not line:
+            continue
+        name, _, explicit = line.partition("=")
+        value = int(explicit, 0) if explicit.strip() else value + 1
+        names[value] = name.strip()
+    return names
+
+
+def iter_traces(data):
+    """Yields (total written, [(ts, id, arg), ...]) for every valid trace frame."""
+    pos = data.find(DUMP_MAGIC)
+    while pos >= 0 and pos + DUMP_HEADER.size <= len(data):
+        _, block_id, encoding, count, length = DUMP_HEADER.unpack_from(data, pos)
+        start = pos + DUMP_HEADER.size
+        end = start + length
+        if block_id != BLOCK_TRACE or encoding != ENC_TRACE or end >= len(data) \
+                or length != 4 + count * TRACE_RECORD.size:
+            pos = data.find(DUMP_MAGIC, pos + 1)
+            continue
+        payload = data[start:end]
+        if (sum(payload) & 0xFF) != data[end]:
+            print("warning: bad checksum at offset %d" % pos, file=sys.stderr)
+            pos = data.find(DUMP_MAGIC, pos + 1)
+            continue
+        total = struct.unpack_from("<I", payload)[0]
+        records = [TRACE_RECORD.unpack_from(payload, 4 + i * TRACE_RECORD.size) for i in range(count)]
+        yield total, records
+        pos = data.find(DUMP_MAGIC, end + 1)
+
+
+def print_timeline(total, records, trace_names, event_names):
+    if total > len(records):
+        print("# %d oldest records overwritten" % (total - len(records)))
+    print("# %12s %10s  %-22s %s" % ("time (us)", "delta (us)", "event", "arg"))
+
+    t = 0
+    previous = records[0][0] if records else 0
+    for ts, trace_id, arg in records:
+        # 32-bit timer wraps every 89 s
+        delta = (ts - previous) & 0xFFFFFFFF
+        previous = ts
+        t += delta
+
+        name = trace_names.get(trace_id, "id_%d" % trace_id)
+        if name in EVENT_TRACES:
+            arg_str = "%s(%d)" % (event_names.get(arg >> 8, "evt_%d" % (arg >> 8)), arg & 0xFF)
+        else:
+            arg_str = str(arg)
+        print("  %12.3f %10.3f  %-22s %s" % (t * 1e6 / TIMER_FREQ, delta * 1e6 / TIMER_FREQ, name, arg_str))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", nargs="?", help="raw serial capture (default: stdin)")
+    parser.add_argument("--inc", default=INC_DIR, help="firmware include directory (event names)")
+    args = parser.parse_args()
+
+    data = open(args.capture, "rb").read() if args.capture else sys.stdin.buffer.read()
+    trace_names = read_enum(os.path.join(args.inc, "trace.h"), "Trace_Id")
+    event_names = read_enum(os.path.join(args.inc, "event.h"), "Event_Id")
+
+    n = 0
+    for total, records in iter_traces(data):
+        print("# trace %d: %d records" % (n, len(records)))
+        print_timeline(total, records, trace_names, event_names)
+        n += 1
+    if n == 0:
+        print("no trace frame found", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()